@@ -0,0 +1,141 @@
+// reads the named colors in rgb.lua and writes colors.h, a perfect hash
+// table of them for text3d
+//
+//   gen_colors rgb.lua > colors.h
+//
+// hash and displace: names are split into buckets by one hash, then each
+// bucket, biggest first, gets the first seed that sends all its names to
+// free slots by a second hash
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// must match color_hash in text3d.cc
+uint32_t color_hash(const char * name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ (seed * 16777619u);
+    for ( ; *name ; name += 1) {
+        hash ^= (unsigned char) *name;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+struct color {
+    string name;
+    double red;
+    double green;
+    double blue;
+};
+
+void die(string message) {
+    cerr << message << endl;
+    exit(1);
+}
+
+// lines look like
+//   aliceblue = {red=0.9411764705882353, green=0.9725490196078431, blue=1.0}
+vector<color> read_colors(string filename) {
+    ifstream f(filename);
+    if (! f) die("can't read " + filename);
+
+    vector<color> colors;
+    string line;
+    while (getline(f, line)) {
+        if (line.empty() || line[0] == '-') continue;
+        color c;
+        char name[256];
+        if (sscanf(line.c_str(), " %255[A-Za-z0-9_] = {red=%lf, green=%lf, blue=%lf}",
+                   name, & c.red, & c.green, & c.blue) != 4) die("can't parse: " + line);
+        c.name = name;
+        colors.push_back(c);
+    }
+    return colors;
+}
+
+// seeds per bucket and the color in each slot, -1 for empty. false if some
+// bucket found no seed
+bool build_table(const vector<color> & colors, int nbuckets, int nslots,
+                 vector<uint32_t> & seeds, vector<int> & slots) {
+    vector<vector<int>> buckets(nbuckets);
+    for (int ix=0 ; ix<(int) colors.size() ; ix+=1) {
+        buckets[color_hash(colors[ix].name.c_str(), 0) % nbuckets].push_back(ix);
+    }
+
+    vector<int> order(nbuckets);
+    for (int b=0 ; b<nbuckets ; b+=1) order[b] = b;
+    stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    seeds.assign(nbuckets, 0);
+    slots.assign(nslots, -1);
+    for (int b : order) {
+        if (buckets[b].empty()) break;
+        bool placed = false;
+        for (uint32_t seed=1 ; seed<0x10000 && ! placed ; seed+=1) {
+            vector<int> taken;
+            for (int ix : buckets[b]) {
+                int slot = color_hash(colors[ix].name.c_str(), seed) % nslots;
+                if (slots[slot] >= 0 || find(taken.begin(), taken.end(), slot) != taken.end()) break;
+                taken.push_back(slot);
+            }
+            if (taken.size() != buckets[b].size()) continue;
+
+            for (int n=0 ; n<(int) taken.size() ; n+=1) slots[taken[n]] = buckets[b][n];
+            seeds[b] = seed;
+            placed = true;
+        }
+        if (! placed) return false;
+    }
+    return true;
+}
+
+int main(int nargs, char * args[]) {
+    if (nargs != 2) die("usage: gen_colors rgb.lua > colors.h");
+
+    vector<color> colors = read_colors(args[1]);
+    int ncolors = colors.size();
+    int nbuckets = (ncolors + 3) / 4;
+
+    vector<uint32_t> seeds;
+    vector<int> slots;
+    int nslots = ncolors;
+    while (! build_table(colors, nbuckets, nslots, seeds, slots)) nslots += ncolors / 16 + 1;
+
+    cout << "// generated by gen_colors from " << args[1] << ", do not edit\n\n";
+    cout << "struct named_color {\n";
+    cout << "    const char * name;\n";
+    cout << "    float red;\n";
+    cout << "    float green;\n";
+    cout << "    float blue;\n";
+    cout << "};\n\n";
+    cout << "const int NCOLORS = " << ncolors << ";\n";
+    cout << "const int COLOR_BUCKETS = " << nbuckets << ";\n";
+    cout << "const int COLOR_SLOTS = " << nslots << ";\n\n";
+
+    cout << "constexpr uint32_t color_seeds[COLOR_BUCKETS] = {";
+    for (int b=0 ; b<nbuckets ; b+=1) cout << (b % 12 ? " " : "\n    ") << seeds[b] << ",";
+    cout << "\n};\n\n";
+
+    cout << "constexpr named_color color_table[COLOR_SLOTS] = {\n";
+    cout.precision(9);
+    for (int slot : slots) {
+        if (slot < 0) {
+            cout << "    {nullptr, 0, 0, 0},\n";
+            continue;
+        }
+        const color & c = colors[slot];
+        cout << "    {\"" << c.name << "\", " << c.red << ", " << c.green << ", " << c.blue << "},\n";
+    }
+    cout << "};\n";
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+#version 330 core
+out vec4 FragColor;
+in vec3 FragPos;
+in vec3 Normal;
+in vec3 Color;
+in vec2 UV;
+uniform vec3 lightPos;
+uniform vec3 lightColor;
+uniform sampler2D atlas;
+uniform float pxRange;
+float median(vec3 v) {
+  return max(min(v.r, v.g), min(max(v.r, v.g), v.b));
+}
+void main() {
+  // coverage from the field, antialiased over about a screen pixel
+  vec2 unitRange = vec2(pxRange) / vec2(textureSize(atlas, 0));
+  vec2 screenTexSize = vec2(1.0) / fwidth(UV);
+  float screenPxRange = max(0.5 * dot(unitRange, screenTexSize), 1.0);
+  float alpha = clamp(screenPxRange * (median(texture(atlas, UV).rgb) - 0.5) + 0.5, 0.0, 1.0);
+  if (alpha < 0.01) discard;
+
+  // lit the same as the face of the letter mesh it stands in for
+  float ambientStrength = 0.1;
+  vec3 ambient = ambientStrength * lightColor;
+  vec3 norm = -normalize(gl_FrontFacing ? Normal : -Normal);
+  vec3 lightDir = normalize(lightPos - FragPos);
+  float diff = max(dot(norm, lightDir), 0.0);
+  vec3 diffuse = diff * lightColor;
+  float specularStrength = 0.25;
+  vec3 viewPos = vec3(0.0, 0.0, 10.0);
+  vec3 viewDir = normalize(viewPos - FragPos);
+  vec3 reflectDir = reflect(-lightDir, norm);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+  vec3 specular = specularStrength * spec * lightColor;
+
+  vec3 result = (ambient + diffuse + specular) * Color;
+  FragColor = vec4(result, alpha);
+}
@@ -0,0 +1,23 @@
+#version 330 core
+layout (location = 0) in mat4 aModel;
+layout (location = 4) in mat3 aNormalMatrix;
+layout (location = 7) in vec4 aRect;
+layout (location = 8) in vec4 aUV;
+layout (location = 9) in vec3 aColor;
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 Color;
+out vec2 UV;
+uniform mat4 projection;
+uniform mat4 view;
+// one quad per letter, in the letter's own space like its mesh, corners
+// from the vertex id of a four vertex strip
+void main() {
+  vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+  vec3 pos = vec3(mix(aRect.xy, aRect.zw, corner), 0.0);
+  FragPos = pos;
+  Normal = aNormalMatrix * vec3(0.0, 0.0, 1.0);
+  Color = aColor;
+  UV = mix(aUV.xy, aUV.zw, corner);
+  gl_Position = projection * view * aModel * vec4(pos, 1.0);
+}
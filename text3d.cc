@@ -1,16 +1,30 @@
+#include <atomic>
+#include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <new>
 #include <fstream>
+#include <deque>
 #include <map>
+#include <mutex>
 #include <random>
 #include <string>
+#include <tuple>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/normal.hpp>
 
@@ -20,6 +34,8 @@
 #include "lauxlib.h"
 #include "lualib.h"
 
+#include "colors.h"
+
 extern "C" {
 #include <SDL.h>
 #include <GL/glew.h>
@@ -32,6 +48,25 @@ extern "C" {
 #include FT_OUTLINE_H
 }
 
+#include <malloc.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using namespace std;
 
 //TODO fix coordinate system mismatch (lefthand vs righthand, +z vs -z)
@@ -48,6 +83,86 @@ void die(string message) {
     exit(1);
 }
 
+// allocations through counted_malloc (the tesselator on the heap, arena
+// blocks) are counted, so stages can report how many they made and how high
+// they took the heap. sizes come from the allocator itself. building with
+// -DCOUNT_HEAP counts every new and delete in the process too, which costs
+// each of them a few atomics, so it is for measuring only
+atomic<long> heap_allocations{0};
+atomic<long> heap_bytes{0};
+atomic<long> heap_peak{0};
+
+size_t heap_block_size(void * p) {
+#ifdef _WIN32
+    return _msize(p);
+#else
+    return malloc_usable_size(p);
+#endif
+}
+
+void count_heap(void * p, long sign) {
+    long size = sign * (long) heap_block_size(p);
+    long bytes = heap_bytes.fetch_add(size) + size;
+    if (sign < 0) return;
+    heap_allocations.fetch_add(1, memory_order_relaxed);
+    long peak = heap_peak.load(memory_order_relaxed);
+    while (bytes > peak && ! heap_peak.compare_exchange_weak(peak, bytes)) {}
+}
+
+void * counted_malloc(size_t size) {
+    void * p = malloc(size ? size : 1);
+    if (p) count_heap(p, 1);
+    return p;
+}
+
+void counted_free(void * p) {
+    if (! p) return;
+    count_heap(p, -1);
+    free(p);
+}
+
+void * counted_realloc(void * p, size_t size) {
+    if (p) count_heap(p, -1);
+    void * q = realloc(p, size);
+    if (q) count_heap(q, 1);
+    else if (p) count_heap(p, 1);
+    return q;
+}
+
+#ifdef COUNT_HEAP
+void * operator new(size_t size) {
+    void * p = counted_malloc(size);
+    if (! p) throw bad_alloc();
+    return p;
+}
+
+void operator delete(void * p) noexcept {
+    counted_free(p);
+}
+
+void operator delete(void * p, size_t) noexcept {
+    counted_free(p);
+}
+#endif
+
+// allocations made and peak growth of the heap between construction and
+// report
+struct heap_window {
+    long allocations = heap_allocations.load();
+    long bytes = heap_bytes.load();
+
+    heap_window() { heap_peak.store(bytes); }
+    void report(string what) {
+#ifdef COUNT_HEAP
+        const char * counted = " heap allocations, peak ";
+#else
+        const char * counted = " counted allocations, peak ";
+#endif
+        cout << what << ": " << heap_allocations.load() - allocations << counted
+             << (heap_peak.load() - bytes) / 1024 << " KB above start" << endl;
+    }
+};
+
 void GLAPIENTRY MessageCallback(
         GLenum source,
         GLenum type,
@@ -59,7 +174,179 @@ void GLAPIENTRY MessageCallback(
     if (type==GL_DEBUG_TYPE_ERROR) cerr << "GL CALLBACK: " << (type==GL_DEBUG_TYPE_ERROR ? "** GL ERROR **" : "") << " type=" << type << " severity=" << severity << " message=" << message << endl;
 }
 
+bool multi_draw_indirect = true;
+
+// frames to run in --bench mode, 0 for the normal interactive run
+int bench_frames = 0;
+string bench_out = "text3d-bench.json";
+
+// --record N renders N frames offscreen at a fixed step and writes them to
+// record_out: "-" for stdout, else a file for raw rgb or a printf pattern
+// such as frame%05d.png for png
+int record_frames = 0;
+string record_out = "-";
+bool record_png = false;
+float record_fps = 60;
+
+// benchmarks and recordings have no window to show and no display to wait on
+bool offline() {
+    return bench_frames > 0 || record_frames > 0;
+}
+
+// always-on profiler. scoped timers on every thread and gl timer queries
+// write complete events into one ring, which --trace FILE exports at exit
+// as a chrome trace (chrome://tracing or ui.perfetto.dev)
+struct profile_event {
+    const char * name; // string literal
+    int track;
+    double start;      // seconds since profile_epoch
+    double duration;
+};
+
+const auto profile_epoch = chrono::steady_clock::now();
+
+double profile_now() {
+    return chrono::duration<double>(chrono::steady_clock::now() - profile_epoch).count();
+}
+
+// track 0 is the gpu, threads get the next free one the first time they
+// record anything
+const int GPU_TRACK = 0;
+const int MAX_TRACKS = 16;
+const char * track_names[MAX_TRACKS] = {"gpu"};
+atomic<int> next_track{1};
+thread_local int profile_track = -1;
+
+int current_track() {
+    if (profile_track < 0) profile_track = next_track.fetch_add(1);
+    return profile_track;
+}
+
+void name_thread(const char * name) {
+    int track = current_track();
+    if (track < MAX_TRACKS) track_names[track] = name;
+}
+
+// writers claim slots with one fetch_add and never wait, the oldest events
+// are overwritten. each slot's sequence number is odd while it is being
+// written so a reader can skip torn events
+const int PROFILE_RING_SIZE = 1 << 16;
+
+struct profile_slot {
+    atomic<uint64_t> seq{0};
+    profile_event event;
+};
+
+struct profile_ring {
+    profile_slot slots[PROFILE_RING_SIZE];
+    atomic<uint64_t> head{0};
+
+    void record(const profile_event & e);
+    vector<profile_event> events();
+};
+
+void profile_ring::record(const profile_event & e) {
+    uint64_t n = head.fetch_add(1, memory_order_relaxed);
+    profile_slot & slot = slots[n % PROFILE_RING_SIZE];
+    slot.seq.store(2*n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot.event = e;
+    slot.seq.store(2*n + 2, memory_order_release);
+}
+
+// the newest events that were completely written, oldest first
+vector<profile_event> profile_ring::events() {
+    uint64_t end = head.load(memory_order_acquire);
+    uint64_t begin = end > PROFILE_RING_SIZE ? end - PROFILE_RING_SIZE : 0;
+    vector<profile_event> out;
+    out.reserve(end - begin);
+    for (uint64_t n=begin ; n<end ; n+=1) {
+        profile_slot & slot = slots[n % PROFILE_RING_SIZE];
+        uint64_t seq = slot.seq.load(memory_order_acquire);
+        if (seq != 2*n + 2) continue;
+        profile_event e = slot.event;
+        atomic_thread_fence(memory_order_acquire);
+        if (slot.seq.load(memory_order_relaxed) != seq) continue;
+        out.push_back(e);
+    }
+    return out;
+}
+
+profile_ring profile;
+string trace_out;
+
+// per stage wall times for --bench, one sample per call. only collected
+// when benchmarking
+mutex stage_lock;
+map<string, vector<double>> stage_times;
+
+// times its scope into the profile ring, and into stage_times when
+// benchmarking
+struct stage_timer {
+    const char * stage;
+    double start = profile_now();
+
+    stage_timer(const char * name) : stage(name) {}
+    ~stage_timer() {
+        double duration = profile_now() - start;
+        profile.record({stage, current_track(), start, duration});
+        if (bench_frames > 0) {
+            lock_guard<mutex> guard(stage_lock);
+            stage_times[stage].push_back(duration);
+        }
+    }
+};
+
+// text as the inside of a json string. driver strings and thread names are
+// whatever they are, quotes and backslashes included
+string json_escape(const string & text) {
+    string out;
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (c < 0x20) {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            out += code;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+void write_trace() {
+    ofstream out(trace_out);
+    if (! out) die("can't write " + trace_out);
+
+    out << fixed << setprecision(3);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    int ntracks = min(next_track.load(), MAX_TRACKS);
+    for (int track=0 ; track<ntracks ; track+=1) {
+        if (! track_names[track]) continue;
+        out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << track
+            << ", \"args\": {\"name\": \"" << json_escape(track_names[track]) << "\"}},\n";
+    }
+    vector<profile_event> events = profile.events();
+    for (size_t ix=0 ; ix<events.size() ; ix+=1) {
+        const profile_event & e = events[ix];
+        out << "{\"name\": \"" << json_escape(e.name) << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << e.track
+            << ", \"ts\": " << e.start * 1e6 << ", \"dur\": " << e.duration * 1e6 << "}"
+            << (ix+1 < events.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+
+    cout << "trace of " << events.size() << " events written to " << trace_out << endl;
+}
+
 void init() {
+#ifndef _WIN32
+    // benchmarks render into an offscreen EGL surface, no display needed.
+    // SDL_VIDEODRIVER in the environment still wins
+    if (offline()) SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+#endif
+
     // init SDL
     if (SDL_Init(SDL_INIT_VIDEO) < 0) die("SDL");
     if (! SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1")) die("texture");
@@ -73,7 +360,7 @@ void init() {
     gWindow = SDL_CreateWindow(WINDOW_NAME, SDL_WINDOWPOS_UNDEFINED,
                                SDL_WINDOWPOS_UNDEFINED,
                                SCREEN_WIDTH, SCREEN_HEIGHT,
-                               SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
+                               SDL_WINDOW_OPENGL | (offline() ? SDL_WINDOW_HIDDEN : SDL_WINDOW_SHOWN));
     if (gWindow == NULL) die("window");
 
     //memset(& gContext, 0, sizeof(gContext));
@@ -83,19 +370,39 @@ void init() {
     // init GLEW
     glewExperimental = GL_TRUE; 
     GLenum glewError = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // a glx build of glew complains under egl but has loaded everything
+    if (glewError == GLEW_ERROR_NO_GLX_DISPLAY) glewError = GLEW_OK;
+#endif
     if (glewError != GLEW_OK) die("glew");
 
+    // benchmarks measure our frame, not the display's refresh
+    if (offline()) SDL_GL_SetSwapInterval(0);
+
     glEnable(GL_DEBUG_OUTPUT);
     glDebugMessageCallback(MessageCallback, 0);
 
+    // core 3.3 is all we ask for, multi-draw indirect is used when present
+    multi_draw_indirect = multi_draw_indirect
+                          && (GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance));
+
     // GL viewport
     glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 }
 
+void stop_glyph_loader();
+void stop_physics();
+void report_glyph_residency();
+
 void close()
 {
     //TODO close OpenGL
 
+    stop_glyph_loader();
+    stop_physics();
+    report_glyph_residency();
+    if (! trace_out.empty()) write_trace();
+
     SDL_DestroyWindow(gWindow);
     gWindow = NULL;
 
@@ -112,23 +419,121 @@ int binomial(int n, int k) {
     return fact(n) / (fact(k) * fact(n-k));
 }
 
-float bernstein_3(int ix, float uv) {
-    return binomial(3, ix) * pow(uv, ix) * pow(1-uv, 3-ix);
+float bernstein(int n, int k, float t) {
+    if (k < 0 || k > n) return 0;
+    return binomial(n, k) * pow(t, k) * pow(1-t, n-k);
 }
 
-glm::vec3 bezier_bicubic_quad(vector<glm::vec3> controls, float u, float v) {
-    glm::vec3 p(0,0,0);
+// bernstein basis of one degree and its derivative, sampled at fineness
+// evenly spaced parameters; indexed [k*fineness + sample]
+struct bezier_basis {
+    vector<float> basis;
+    vector<float> deriv;
+};
 
-    for (int i=0 ; i<4 ; i+=1) {
-        for (int j=0 ; j<4 ; j+=1) {
-            p += bernstein_3(i, u) * bernstein_3(j, v) * controls[i*4 + j];
+const bezier_basis & get_basis(int degree, int fineness) {
+    static map<pair<int, int>, bezier_basis> tables;
+    auto key = make_pair(degree, fineness);
+    auto it = tables.find(key);
+    if (it != tables.end()) return it->second;
+
+    bezier_basis & b = tables[key];
+    b.basis.resize((degree+1) * fineness);
+    b.deriv.resize((degree+1) * fineness);
+    for (int ix=0 ; ix<fineness ; ix+=1) {
+        float t = ix / float(fineness-1);
+        for (int k=0 ; k<=degree ; k+=1) {
+            b.basis[k*fineness + ix] = bernstein(degree, k, t);
+            b.deriv[k*fineness + ix] = degree * (bernstein(degree-1, k-1, t) - bernstein(degree-1, k, t));
         }
     }
+    return b;
+}
 
-    return p;
+// control points are stored v-major, as in the .bpt file
+struct bezier_patch {
+    int uorder;
+    int vorder;
+    vector<glm::vec3> controls;
+};
+
+// sample a patch on a fineness x fineness grid, [i*fineness + j] with i
+// running along v and j along u. the patch is evaluated as two small matrix
+// products against the basis tables, one coordinate plane at a time so the
+// inner loops run over contiguous floats
+void evaluate_patch(const bezier_patch & patch, int fineness,
+                    vector<glm::vec3> & points, vector<glm::vec3> & normals) {
+    const int tf = fineness;
+    const int nv = patch.vorder + 1;
+    const int nu = patch.uorder + 1;
+    const bezier_basis & bv = get_basis(patch.vorder, tf);
+    const bezier_basis & bu = get_basis(patch.uorder, tf);
+
+    // q[a][j] = sum over b of controls[a][b] * bu[b][j], and its u derivative
+    vector<float> q(3 * nv * tf, 0.0f);
+    vector<float> dq(3 * nv * tf, 0.0f);
+    for (int c=0 ; c<3 ; c+=1) {
+        for (int a=0 ; a<nv ; a+=1) {
+            float * qrow = & q[(c*nv + a) * tf];
+            float * dqrow = & dq[(c*nv + a) * tf];
+            for (int b=0 ; b<nu ; b+=1) {
+                float p = patch.controls[a*nu + b][c];
+                const float * w = & bu.basis[b*tf];
+                const float * dw = & bu.deriv[b*tf];
+                for (int j=0 ; j<tf ; j+=1) {
+                    qrow[j] += p * w[j];
+                    dqrow[j] += p * dw[j];
+                }
+            }
+        }
+    }
+
+    // position and both partials: sum over a of bv[a][i] * q[a][j]
+    vector<float> pos(3 * tf * tf, 0.0f);
+    vector<float> dv(3 * tf * tf, 0.0f);
+    vector<float> du(3 * tf * tf, 0.0f);
+    for (int c=0 ; c<3 ; c+=1) {
+        for (int i=0 ; i<tf ; i+=1) {
+            float * prow = & pos[(c*tf + i) * tf];
+            float * dvrow = & dv[(c*tf + i) * tf];
+            float * durow = & du[(c*tf + i) * tf];
+            for (int a=0 ; a<nv ; a+=1) {
+                float w = bv.basis[a*tf + i];
+                float dw = bv.deriv[a*tf + i];
+                const float * qrow = & q[(c*nv + a) * tf];
+                const float * dqrow = & dq[(c*nv + a) * tf];
+                for (int j=0 ; j<tf ; j+=1) {
+                    prow[j] += w * qrow[j];
+                    dvrow[j] += dw * qrow[j];
+                    durow[j] += w * dqrow[j];
+                }
+            }
+        }
+    }
+
+    points.resize(tf * tf);
+    normals.resize(tf * tf);
+    const int plane = tf * tf;
+    for (int ix=0 ; ix<plane ; ix+=1) {
+        points[ix] = {pos[ix], pos[plane + ix], pos[2*plane + ix]};
+        glm::vec3 n = glm::cross(glm::vec3(du[ix], du[plane + ix], du[2*plane + ix]),
+                                 glm::vec3(dv[ix], dv[plane + ix], dv[2*plane + ix]));
+        float len = glm::length(n);
+        normals[ix] = len > 1e-6f ? n / len : glm::vec3(0, 0, 0);
+    }
+
+    // a collapsed edge (like the pole of the lid) has no normal of its own,
+    // borrow the one from the next row in
+    for (int i=0 ; i<tf ; i+=1) {
+        for (int j=0 ; j<tf ; j+=1) {
+            if (normals[i*tf + j] != glm::vec3(0, 0, 0)) continue;
+            int inner = i < tf/2 ? i+1 : i-1;
+            normals[i*tf + j] = normals[inner*tf + j];
+        }
+    }
 }
 
-void load_patches(string filename, vector<vector<glm::vec3>> & patches) {
+void load_patches(string filename, vector<bezier_patch> & patches) {
     ifstream f(filename);
     string line;
 
@@ -138,16 +543,15 @@ void load_patches(string filename, vector<vector<glm::vec3>> & patches) {
 
     for (int ix=0 ; ix<npatches ; ix+=1) {
         getline(f, line);
-        int uorder, vorder;
-        istringstream(line) >> uorder >> vorder;
+        bezier_patch patch;
+        istringstream(line) >> patch.uorder >> patch.vorder;
 
-        vector<glm::vec3> patch = {};
-        for (int v=0 ; v<=vorder ; v+=1) {
-            for (int u=0 ; u<=uorder ; u+=1) {
+        for (int v=0 ; v<=patch.vorder ; v+=1) {
+            for (int u=0 ; u<=patch.uorder ; u+=1) {
                 getline(f, line);
                 glm::vec3 p;
                 istringstream(line) >> p.x >> p.y >> p.z;
-                patch.push_back(p);
+                patch.controls.push_back(p);
             }
         }
         patches.push_back(patch);
@@ -161,593 +565,3846 @@ void add_point(vector<float> & values, glm::vec3 point) {
     values.push_back(point.z);
 }
 
-GLuint teapot_VAO;
-int teapot_ntris;
-rp3d::RigidBody * teapot_body;
-
-const int TEAPOT_FINENESS = 10;
-void load_teapot() {
-    // load teapot bezier patch control points
-    vector<vector<glm::vec3>> patches = {};
-    load_patches("teapotCGA.bpt", patches);
-
-    // convert bezier patches to triangle meshes
-    const int tf = TEAPOT_FINENESS;
-    vector<float> coords = {};
-    for (auto patch : patches) {
-        //TODO fix assumption of bicubic patches
-        //TODO make sure uv coordinates match (important?)
-        glm::vec3 ps[tf][tf];
-        for (int i=0 ; i<tf ; i+=1) {
-            for (int j=0 ; j<tf ; j+=1) {
-                ps[i][j] = bezier_bicubic_quad(patch, i/float(tf-1), j/float(tf-1));
-            }
-        }
-        
-        for (int ix=0 ; ix<tf-1 ; ix+=1) {
-            for (int jx=0 ; jx<tf-1 ; jx+=1) {
-                glm::vec3 normal = glm::triangleNormal(
-                        ps[ix][jx],
-                        ps[ix][jx+1],
-                        ps[ix+1][jx]
-                );
-
-                add_point(coords, ps[ix][jx]);
-                add_point(coords, normal);
-                add_point(coords, ps[ix][jx+1]);
-                add_point(coords, normal);
-                add_point(coords, ps[ix+1][jx]);
-                add_point(coords, normal);
-
-                add_point(coords, ps[ix+1][jx+1]);
-                add_point(coords, normal);
-                add_point(coords, ps[ix+1][jx]);
-                add_point(coords, normal);
-                add_point(coords, ps[ix][jx+1]);
-                add_point(coords, normal);
-            }
-        }
+uint64_t fnv1a(const void * data, size_t size, uint64_t hash=0xcbf29ce484222325ull) {
+    const unsigned char * bytes = (const unsigned char *) data;
+    for (size_t ix=0 ; ix<size ; ix+=1) {
+        hash ^= bytes[ix];
+        hash *= 0x100000001b3ull;
     }
+    return hash;
+}
 
-    glGenVertexArrays(1, & teapot_VAO);
+// meshes are built as triangle soup of interleaved position/normal floats,
+// then welded, indexed and packed before they go to the gpu:
+//   position  3 floats, or 4 half floats with --half-positions
+//   normal    GL_INT_2_10_10_10_REV, normalized
+const int SOUP_FLOATS = 6;
+bool half_positions = false;
 
-    GLuint VBO;
-    glGenBuffers(1, & VBO);
+int vertex_stride() {
+    return half_positions ? 12 : 16;
+}
 
-    glBindVertexArray(teapot_VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+struct packed_vertex {
+    uint32_t words[4] = {0, 0, 0, 0};
 
-    teapot_ntris = coords.size() / 6;
-    glBufferData(GL_ARRAY_BUFFER, coords.size() * sizeof(float), & coords[0], GL_STATIC_DRAW);
+    bool operator==(const packed_vertex & other) const {
+        return memcmp(words, other.words, sizeof(words)) == 0;
+    }
+};
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), nullptr);
-    glEnableVertexAttribArray(0);
+struct packed_vertex_hash {
+    size_t operator()(const packed_vertex & v) const {
+        return fnv1a(v.words, sizeof(v.words));
+    }
+};
 
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (void *) (3*sizeof(float)));
-    glEnableVertexAttribArray(1);
+uint32_t pack_snorm10(float v) {
+    int q = (int) round(glm::clamp(v, -1.0f, 1.0f) * 511.0f);
+    return q & 0x3ff;
 }
 
-GLuint shaderProgram;
-
-void draw_teapot() {
-    auto model = glm::mat4(1.0f);
-    model = glm::scale(model, glm::vec3(0.5, 0.5, 0.5));
-    model = glm::translate(model, glm::vec3(0, -2, 0));
-    model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1, 0, 0));
-    //model = glm::rotate(model, glm::radians(-15.0f), glm::vec3(0, 0, 1));
-
-    //TODO something with teapot_body
-    glm::mat4 phys_model;
-    teapot_body->getTransform().getOpenGLMatrix(glm::value_ptr(phys_model));
-    model = phys_model * model;
-
-    glm::vec3 color = {1.0, 1.0, 1.0};
+packed_vertex pack_vertex(const float * soup) {
+    packed_vertex v;
+    uint32_t normal = pack_snorm10(soup[3]) | (pack_snorm10(soup[4]) << 10) | (pack_snorm10(soup[5]) << 20);
+    if (half_positions) {
+        v.words[0] = glm::packHalf1x16(soup[0]) | (glm::packHalf1x16(soup[1]) << 16);
+        v.words[1] = glm::packHalf1x16(soup[2]) | (glm::packHalf1x16(1.0f) << 16);
+        v.words[2] = normal;
+    } else {
+        memcpy(& v.words[0], & soup[0], 3*sizeof(float));
+        v.words[3] = normal;
+    }
+    return v;
+}
 
-    unsigned int modelLoc = glGetUniformLocation(shaderProgram, "model");
-    unsigned int objectColorLoc = glGetUniformLocation(shaderProgram, "objectColor");
+// gpu-ready indexed mesh; indices are 16 bit when they fit
+struct mesh_data {
+    vector<char> vertices;
+    vector<char> indices;
+    int nvertices = 0;
+    int nindices = 0;
+    bool wide_indices = false;
 
-    glBindVertexArray(teapot_VAO);
+    size_t bytes() const { return vertices.size() + indices.size(); }
+};
 
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniform3fv(objectColorLoc, 1, glm::value_ptr(color));
+// bump allocator: an allocation is a pointer increment and nothing is freed
+// until reset, which keeps the blocks for the next round
+struct bump_arena {
+    static const size_t BLOCK_SIZE = 256 << 10;
+
+    vector<pair<char *, size_t>> blocks;
+    size_t block = 0; // current block
+    size_t used = 0;  // bytes of it taken
+    size_t in_use = 0;
+    size_t peak = 0;  // most bytes handed out between resets
+    long nallocs = 0;
+
+    void * alloc(size_t size, size_t align = alignof(max_align_t));
+    void reset();
+    size_t capacity() const;
+    ~bump_arena();
+};
 
-    glDrawArrays(GL_TRIANGLES, 0, teapot_ntris);
+void * bump_arena::alloc(size_t size, size_t align) {
+    nallocs += 1;
+    in_use += size;
+    peak = max(peak, in_use);
+    while (true) {
+        if (block == blocks.size()) {
+            size_t bytes = max(BLOCK_SIZE, size + align);
+            blocks.push_back({(char *) counted_malloc(bytes), bytes});
+            if (! blocks.back().first) die("out of memory");
+        }
+        size_t start = (used + align - 1) & ~(align - 1);
+        if (start + size <= blocks[block].second) {
+            used = start + size;
+            return blocks[block].first + start;
+        }
+        block += 1;
+        used = 0;
+    }
 }
 
-FT_Library ft;
-FT_Face face;
+void bump_arena::reset() {
+    block = 0;
+    used = 0;
+    in_use = 0;
+}
 
-// TODO move divide by font_size into pl_funcs
-int pl_moveto(const FT_Vector * FT_to, void * user) {
-    auto * polylines = (vector<vector<glm::vec3>> *) user;
-    vector<glm::vec3> polyline = {{FT_to->x, FT_to->y, 0.0}};
-    polylines->push_back(polyline);
-    return 0;
+size_t bump_arena::capacity() const {
+    size_t bytes = 0;
+    for (auto & b : blocks) bytes += b.second;
+    return bytes;
 }
 
-int pl_lineto(const FT_Vector * FT_to, void * user) {
-    auto * polylines = (vector<vector<glm::vec3>> *) user;
-    vector<glm::vec3> & polyline = polylines->back();
-    polyline.push_back({FT_to->x, FT_to->y, 0.0});
-    return 0;
+bump_arena::~bump_arena() {
+    for (auto & b : blocks) counted_free(b.first);
 }
 
-int pl_conicto(const FT_Vector * FT_ctl, const FT_Vector * FT_to, void * user) {
-    auto * polylines = (vector<vector<glm::vec3>> *) user;
-    vector<glm::vec3> & polyline = polylines->back();
+// standard allocator over a bump_arena, or the heap when it has none
+template<class T> struct arena_allocator {
+    typedef T value_type;
+    bump_arena * arena;
 
-    glm::vec3 & from = polyline.back();
-    glm::vec3 ctl = {FT_ctl->x, FT_ctl->y, 0.0};
-    glm::vec3 to = {FT_to->x, FT_to->y, 0.0};
+    arena_allocator(bump_arena * a=nullptr) : arena(a) {}
+    template<class U> arena_allocator(const arena_allocator<U> & other) : arena(other.arena) {}
 
-    glm::vec3 mid = 0.25f * from + 0.5f * ctl + 0.25f * to;
+    T * allocate(size_t n) {
+        if (arena) return (T *) arena->alloc(n * sizeof(T), alignof(T));
+        return (T *) ::operator new(n * sizeof(T));
+    }
+    void deallocate(T * p, size_t) {
+        if (! arena) ::operator delete(p);
+    }
+    template<class U> bool operator==(const arena_allocator<U> & other) const { return arena == other.arena; }
+    template<class U> bool operator!=(const arena_allocator<U> & other) const { return arena != other.arena; }
+};
 
-    polyline.push_back(mid);
-    polyline.push_back(to);
-    return 0;
-}
+template<class T> using scratch_vector = vector<T, arena_allocator<T>>;
 
-int pl_cubicto(const FT_Vector * FT_ctl1, const FT_Vector * FT_ctl2,
-            const FT_Vector * FT_to, void * user) {
-    auto * polylines = (vector<vector<glm::vec3>> *) user;
-    vector<glm::vec3> & polyline = polylines->back();
+// reorder triangles for the post-transform vertex cache, after Tom Forsyth's
+// "linear-speed vertex cache optimisation"
+const int VERTEX_CACHE_SIZE = 32;
 
-    glm::vec3 & from = polyline.back();
-    glm::vec3 ctl1 = {FT_ctl1->x, FT_ctl1->y, 0.0};
-    glm::vec3 ctl2 = {FT_ctl2->x, FT_ctl2->y, 0.0};
-    glm::vec3 to = {FT_to->x, FT_to->y, 0.0};
+float vertex_cache_score(int cache_pos, int remaining) {
+    if (remaining == 0) return -1;
+    float score = 0;
+    if (cache_pos >= 0) {
+        if (cache_pos < 3) score = 0.75;
+        else score = pow(1 - (cache_pos - 3) / float(VERTEX_CACHE_SIZE - 3), 1.5f);
+    }
+    return score + 2 * pow(float(remaining), -0.5f);
+}
 
-    glm::vec3 mid1 = 0.2963f * from + 0.4444f * ctl1 + 0.2222f * ctl2
-                     + 0.0370f * to;
-    glm::vec3 mid2 = 0.0370f * from + 0.2222f * ctl1 + 0.4444f * ctl2
-                     + 0.2963f * to;
+void optimize_vertex_cache(scratch_vector<uint32_t> & indices, int nvertices) {
+    int ntris = indices.size() / 3;
+    if (ntris == 0) return;
+    arena_allocator<int> alloc(indices.get_allocator());
+
+    // triangles using each vertex
+    scratch_vector<int> remaining(nvertices, 0, alloc);
+    for (uint32_t v : indices) remaining[v] += 1;
+    scratch_vector<int> tri_start(nvertices + 1, 0, alloc);
+    for (int v=0 ; v<nvertices ; v+=1) tri_start[v+1] = tri_start[v] + remaining[v];
+    scratch_vector<int> vertex_tris(indices.size(), 0, alloc);
+    scratch_vector<int> fill(tri_start.begin(), tri_start.end() - 1, alloc);
+    for (int t=0 ; t<ntris ; t+=1) {
+        for (int k=0 ; k<3 ; k+=1) vertex_tris[fill[indices[t*3 + k]]++] = t;
+    }
 
-    polyline.push_back(mid1);
-    polyline.push_back(mid2);
-    polyline.push_back(to);
-    return 0;
-}
+    scratch_vector<int> cache_pos(nvertices, -1, alloc);
+    scratch_vector<float> vscore(nvertices, 0.0f, alloc);
+    for (int v=0 ; v<nvertices ; v+=1) vscore[v] = vertex_cache_score(-1, remaining[v]);
 
-FT_Outline_Funcs pl_funcs = {& pl_moveto, & pl_lineto,
-                             & pl_conicto, & pl_cubicto,
-                             0, 0};
+    scratch_vector<float> tscore(ntris, 0.0f, alloc);
+    int best = 0;
+    for (int t=0 ; t<ntris ; t+=1) {
+        tscore[t] = vscore[indices[t*3]] + vscore[indices[t*3+1]] + vscore[indices[t*3+2]];
+        if (tscore[t] > tscore[best]) best = t;
+    }
 
-float font_size;
-vector<float> front_vertices;
-vector<float> back_vertices;
+    scratch_vector<char> emitted(ntris, 0, alloc);
+    scratch_vector<uint32_t> out(indices.get_allocator());
+    out.reserve(indices.size());
+    scratch_vector<int> cache(alloc);
+    scratch_vector<int> touched(alloc);
+    int scan_from = 0;
+
+    while ((int) out.size() < ntris*3) {
+        if (best < 0) {
+            // nothing in the cache has triangles left, start somewhere new
+            while (emitted[scan_from]) scan_from += 1;
+            best = scan_from;
+        }
+        emitted[best] = 1;
+
+        touched = cache;
+        for (int k=0 ; k<3 ; k+=1) {
+            int v = indices[best*3 + k];
+            out.push_back(v);
+            remaining[v] -= 1;
+            auto at = find(cache.begin(), cache.end(), v);
+            if (at != cache.end()) cache.erase(at);
+            cache.insert(cache.begin(), v);
+            touched.push_back(v);
+        }
+        if ((int) cache.size() > VERTEX_CACHE_SIZE) cache.resize(VERTEX_CACHE_SIZE);
+
+        for (int v : touched) cache_pos[v] = -1;
+        for (int ix=0 ; ix<(int) cache.size() ; ix+=1) cache_pos[cache[ix]] = ix;
+        for (int v : touched) vscore[v] = vertex_cache_score(cache_pos[v], remaining[v]);
+
+        // only triangles around the cache can have changed score
+        best = -1;
+        float best_score = -1;
+        for (int v : cache) {
+            for (int ix=tri_start[v] ; ix<tri_start[v+1] ; ix+=1) {
+                int t = vertex_tris[ix];
+                if (emitted[t]) continue;
+                tscore[t] = vscore[indices[t*3]] + vscore[indices[t*3+1]] + vscore[indices[t*3+2]];
+                if (tscore[t] > best_score) {
+                    best_score = tscore[t];
+                    best = t;
+                }
+            }
+        }
+    }
 
-const float THICKNESS = 0.25;
+    indices.swap(out);
+}
 
-struct Character {
-    float advance_x;
-    float top;
-    float bot;
-    GLuint VAO;
-    int ntris;
-};
+// vertices are interleaved position/normal floats, indexed in triangles, or
+// unindexed triangles when triangles is null. scratch space comes from the
+// arena if there is one
+void build_mesh(const float * vertices, int nin, const uint32_t * triangles, int ntriangle_indices,
+                mesh_data & mesh, bump_arena * scratch=nullptr) {
+    arena_allocator<char> alloc(scratch);
+
+    // weld vertices that quantize to the same bits
+    unordered_map<packed_vertex, uint32_t, packed_vertex_hash, equal_to<packed_vertex>,
+                  arena_allocator<pair<const packed_vertex, uint32_t>>> welded(alloc);
+    welded.reserve(nin);
+    scratch_vector<packed_vertex> unique(alloc);
+    unique.reserve(nin);
+    scratch_vector<uint32_t> remap(nin, 0, alloc);
+    for (int ix=0 ; ix<nin ; ix+=1) {
+        packed_vertex v = pack_vertex(& vertices[ix * SOUP_FLOATS]);
+        auto it = welded.emplace(v, unique.size());
+        if (it.second) unique.push_back(v);
+        remap[ix] = it.first->second;
+    }
 
-vector<Character> Characters(128);
+    // welding can collapse triangles that had a zero-length edge
+    if (! triangles) ntriangle_indices = nin;
+    scratch_vector<uint32_t> indices(alloc);
+    indices.reserve(ntriangle_indices);
+    for (int t=0 ; t+2<ntriangle_indices ; t+=3) {
+        uint32_t a = remap[triangles ? triangles[t] : t];
+        uint32_t b = remap[triangles ? triangles[t+1] : t+1];
+        uint32_t c = remap[triangles ? triangles[t+2] : t+2];
+        if (a == b || b == c || a == c) continue;
+        indices.insert(indices.end(), {a, b, c});
+    }
 
-void load_glyphs() {
-    if (FT_Init_FreeType(& ft)) die("freetype");
-    if (FT_New_Face(ft, "georgiab.ttf", 0, & face)) die("font");
-    font_size = face->units_per_EM;
+    optimize_vertex_cache(indices, unique.size());
 
-    for (char c=0 ; c<=126 ; c+=1) { // char 127 hangs for some reason
-        if (FT_Load_Char(face, c, FT_LOAD_NO_SCALE)) die("glyph");
+    int stride = vertex_stride();
+    mesh.nvertices = unique.size();
+    mesh.vertices.resize(mesh.nvertices * stride);
+    for (int ix=0 ; ix<mesh.nvertices ; ix+=1) {
+        memcpy(& mesh.vertices[ix * stride], unique[ix].words, stride);
+    }
 
-        // decompose glyph to polyline
-        FT_Outline outline = face->glyph->outline;
-        vector<vector<glm::vec3>> polylines;
-        FT_Outline_Decompose(& outline, & pl_funcs, (void *) & polylines);
+    mesh.nindices = indices.size();
+    mesh.wide_indices = mesh.nvertices > 0xffff;
+    if (mesh.wide_indices) {
+        mesh.indices.resize(mesh.nindices * sizeof(uint32_t));
+        memcpy(mesh.indices.data(), indices.data(), mesh.indices.size());
+    } else {
+        mesh.indices.resize(mesh.nindices * sizeof(uint16_t));
+        uint16_t * narrow = (uint16_t *) mesh.indices.data();
+        for (int ix=0 ; ix<mesh.nindices ; ix+=1) narrow[ix] = indices[ix];
+    }
+}
 
-        // mesh polylines to triangles (both front and back face)
-        TESStesselator * tobj = tessNewTess(nullptr);
-        if (! tobj) die("tesselator");
-        tessSetOption(tobj, TESS_CONSTRAINED_DELAUNAY_TRIANGULATION, 1);
+void build_mesh(const vector<float> & vertices, const vector<uint32_t> & triangles, mesh_data & mesh) {
+    if (triangles.empty()) {
+        mesh = mesh_data();
+        return;
+    }
+    build_mesh(vertices.data(), vertices.size() / SOUP_FLOATS, triangles.data(), triangles.size(), mesh);
+}
 
-        front_vertices = {};
-        back_vertices = {};
+// soup is unindexed triangles
+void build_mesh(const vector<float> & soup, mesh_data & mesh) {
+    build_mesh(soup.data(), soup.size() / SOUP_FLOATS, nullptr, 0, mesh);
+}
 
-        for (vector<glm::vec3> & polyline : polylines) {
-            tessAddContour(tobj, 3, & polyline[0], 3*sizeof(float), polyline.size());
-        }
-        tessTesselate(tobj, TESS_WINDING_ODD, TESS_POLYGONS, 3, 3, nullptr);
+// gpu memory of a set of meshes, against the float triangle soup they
+// replaced (one soup vertex per index)
+void report_mesh_bytes(string what, int nmeshes, size_t soup_vertices, size_t bytes) {
+    if (nmeshes == 0) return;
+    size_t soup_bytes = soup_vertices * SOUP_FLOATS * sizeof(float);
+    cout << what << ": " << soup_bytes / nmeshes << " bytes/mesh as float triangle soup, "
+         << bytes / nmeshes << " bytes/mesh indexed ("
+         << (bytes ? soup_bytes / double(bytes) : 0) << "x smaller)" << endl;
+}
 
-        glm::vec3 z(0, 0, THICKNESS/2);
-        glm::vec3 norm(0, 0, -1);
-        glm::vec3 p;
+// ranges given back to a gpu buffer, reused first fit before the buffer
+// grows. neighbours merge so evicted glyphs don't crumble it into pieces too
+// small for the next one
+struct free_list {
+    map<size_t, size_t> ranges; // offset -> bytes
+    size_t bytes = 0;
 
-        const float * verts = tessGetVertices(tobj);
-        const int * elems = tessGetElements(tobj);
-        //cout << c << " -> " << "verts:" << verts << " elems:" << elems << " nelems:" << tessGetElementCount(tobj) << endl;
-        /*
-        for (int ix=0 ; ix<tessGetElementCount(tobj) ; ix+=1) {
-            for (int n=0 ; n<3 ; n+=1) {
-                const float * vert = & verts[elems[ix*3 + n]];
-                p = {vert[0]/font_size, vert[1]/font_size, vert[2]/font_size};
-
-                add_point(front_vertices, p-z);
-                add_point(front_vertices, norm);
-                add_point(back_vertices, p+z);
-                add_point(back_vertices, -norm);
-            }
-        }
-        */
-        for (int ix=0 ; ix<tessGetElementCount(tobj) ; ix+=1) {
-            const int * p = & elems[ix * 3];
-            for (int j=0 ; j<3 ; j+=1) {
-                glm::vec3 point = {verts[p[j]*3]/font_size, verts[p[j]*3+1]/font_size, 0};
-                add_point(front_vertices, point-z);
-                add_point(front_vertices, norm);
-                add_point(back_vertices, point+z);
-                add_point(back_vertices, -norm);
-            }
-        }
+    bool take(size_t size, size_t align, size_t & offset);
+    void give(size_t offset, size_t size);
+};
 
-        tessDeleteTess(tobj); // for some reason not deleting kills rp3d, shrug
-
-        // add sides
-        float font_ratio = 1/font_size;
-        auto half_deep = glm::vec3(0,0,THICKNESS/2);
-        vector<float> side_vertices = {};
-        for (auto & polyline : polylines) {
-            auto prev_point = polyline.back();
-            for (glm::vec3 & point : polyline) {
-                //TODO blend normals between adjacent faces
-                glm::vec3 normal = glm::triangleNormal(
-                        prev_point * font_ratio - half_deep,
-                        point * font_ratio + half_deep,
-                        point * font_ratio - half_deep
-                );
-
-                add_point(side_vertices, point * font_ratio + half_deep);
-                add_point(side_vertices, normal);
-                add_point(side_vertices, prev_point * font_ratio - half_deep);
-                add_point(side_vertices, normal);
-                add_point(side_vertices, point * font_ratio - half_deep);
-                add_point(side_vertices, normal);
-
-                add_point(side_vertices, point * font_ratio + half_deep);
-                add_point(side_vertices, normal);
-                add_point(side_vertices, prev_point * font_ratio + half_deep);
-                add_point(side_vertices, normal);
-                add_point(side_vertices, prev_point * font_ratio - half_deep);
-                add_point(side_vertices, normal);
+bool free_list::take(size_t size, size_t align, size_t & offset) {
+    if (size == 0) return false;
+    for (auto it = ranges.begin() ; it != ranges.end() ; ++it) {
+        size_t start = it->first, end = it->first + it->second;
+        size_t aligned = (start + align - 1) / align * align;
+        if (aligned + size > end) continue;
+
+        ranges.erase(it);
+        if (aligned > start) ranges[start] = aligned - start;
+        if (aligned + size < end) ranges[aligned + size] = end - aligned - size;
+        bytes -= size;
+        offset = aligned;
+        return true;
+    }
+    return false;
+}
 
-                prev_point = point;
-            }
+void free_list::give(size_t offset, size_t size) {
+    if (size == 0) return;
+    bytes += size;
+    auto next = ranges.lower_bound(offset);
+    if (next != ranges.end() && offset + size == next->first) {
+        size += next->second;
+        next = ranges.erase(next);
+    }
+    if (next != ranges.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
         }
+    }
+    ranges[offset] = size;
+}
+
+// every glyph mesh and the teapot live in one vertex buffer and one index
+// buffer behind one VAO, so drawing never switches buffers
+struct mesh_ref {
+    int first_index; // counted in indices of the mesh's own width
+    int count;
+    int base_vertex;
+    bool wide_indices;
+    int nvertices;
+
+    size_t index_offset() const { return first_index * (wide_indices ? 4 : 2); }
+    size_t bytes() const { return nvertices * vertex_stride() + count * (wide_indices ? 4 : 2); }
+};
 
-        // send triangles to opengl
-        Character & ch = Characters[c];
-        ch.advance_x = face->glyph->advance.x / font_size;
+// meshes are only released by glyph eviction, everything else keeps its
+// space for the life of the program
+struct mesh_arena {
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+    GLuint IBO = 0;
+    size_t vertex_capacity = 0; // in bytes
+    size_t vertex_used = 0;
+    size_t index_capacity = 0; // in bytes
+    size_t index_used = 0;
+    free_list free_vertices;
+    free_list free_indices;
+
+    void init(size_t initial_bytes);
+    void reserve(size_t vertex_bytes, size_t index_bytes);
+    mesh_ref alloc(const char * vertices, int nvertices, const char * indices, int nindices, bool wide_indices);
+    mesh_ref alloc(const mesh_data & mesh);
+    void release(const mesh_ref & mesh);
+    void bind_vertices();
+};
 
-        glGenVertexArrays(1, & ch.VAO);
+void mesh_arena::init(size_t initial_bytes) {
+    glGenVertexArrays(1, & VAO);
+    glGenBuffers(1, & VBO);
+    glGenBuffers(1, & IBO);
+    vertex_capacity = initial_bytes;
+    index_capacity = initial_bytes;
 
-        GLuint VBO;
-        glGenBuffers(1, & VBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertex_capacity, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_capacity, nullptr, GL_STATIC_DRAW);
+    bind_vertices();
+}
 
-        glBindVertexArray(ch.VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+void mesh_arena::bind_vertices() {
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
 
-        vector<float> vertices;
-        vertices.reserve(front_vertices.size() + back_vertices.size() + side_vertices.size());
-        vertices.insert(vertices.end(), front_vertices.begin(), front_vertices.end());
-        vertices.insert(vertices.end(), back_vertices.begin(), back_vertices.end());
-        vertices.insert(vertices.end(), side_vertices.begin(), side_vertices.end());
+    // vertex positions
+    if (half_positions) glVertexAttribPointer(0, 4, GL_HALF_FLOAT, GL_FALSE, vertex_stride(), nullptr);
+    else glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, vertex_stride(), nullptr);
+    glEnableVertexAttribArray(0);
 
-        ch.ntris = vertices.size() / 6;
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), & vertices[0], GL_STATIC_DRAW);
+    // vertex normals
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, vertex_stride(),
+                          (void *) (size_t) (half_positions ? 8 : 12));
+    glEnableVertexAttribArray(1);
+}
 
-        // vertex positions
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), nullptr);
-        glEnableVertexAttribArray(0);
+// copy a buffer into a bigger one on the gpu
+GLuint grow_buffer(GLuint buffer, size_t used, size_t new_capacity) {
+    GLuint new_buffer;
+    glGenBuffers(1, & new_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, new_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, new_capacity, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+    glDeleteBuffers(1, & buffer);
+    return new_buffer;
+}
 
-        // vertex normals
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (void *) (3*sizeof(float)));
-        glEnableVertexAttribArray(1);
+// grow to hold at least this many more bytes
+void mesh_arena::reserve(size_t vertex_bytes, size_t index_bytes) {
+    index_bytes += 4; // room to align wide indices
+    bool grown = false;
+    if (vertex_used + vertex_bytes > vertex_capacity) {
+        size_t new_capacity = max(vertex_capacity * 2, vertex_used + vertex_bytes);
+        VBO = grow_buffer(VBO, vertex_used, new_capacity);
+        vertex_capacity = new_capacity;
+        grown = true;
     }
+    if (index_used + index_bytes > index_capacity) {
+        size_t new_capacity = max(index_capacity * 2, index_used + index_bytes);
+        IBO = grow_buffer(IBO, index_used, new_capacity);
+        index_capacity = new_capacity;
+        grown = true;
+    }
+    if (grown) bind_vertices();
 }
 
-//TODO load shaders from files
-//TODO implement physically based materials
-void setup_shaders() {
-    // vertex shader
-    const char * vertex_shader_code =
-        "#version 330 core\n"
-        "layout (location = 0) in vec3 aPos;\n"
-        "layout (location = 1) in vec3 aNormal;\n"
-        "out vec3 FragPos;\n"
-        "out vec3 Normal;\n"
-        "uniform mat4 projection;\n"
-        "uniform mat4 view;\n"
-        "uniform mat4 model;\n"
-        "void main() {\n"
-        "  FragPos = aPos;\n"
-        "  Normal = mat3(transpose(inverse(model))) * aNormal;\n"
-        "  gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
-        "}";
-    unsigned int vertexShader;
-    vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, & vertex_shader_code, NULL);
-    glCompileShader(vertexShader);
-    int success;
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, & success);
-    if (! success) {
-        char infoLog[512];
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        cout << infoLog << endl;
-        die("vertex shader");
-    }
-
-    // fragment shader
-    const char * fragment_shader_code = 
-        "#version 330 core\n"
-        "out vec4 FragColor;\n"
-        "in vec3 FragPos;\n"
-        "in vec3 Normal;\n"
-        "uniform vec3 lightPos;\n"
-        "uniform vec3 lightColor;\n"
-        "uniform vec3 objectColor;\n"
-        "void main() {\n"
-        "  float ambientStrength = 0.1;\n"
-        "  vec3 ambient = ambientStrength * lightColor;\n"
-        "  vec3 norm = -normalize(Normal);\n" //TODO unminus this?
-        "  vec3 lightDir = normalize(lightPos - FragPos);\n"
-        "  float diff = max(dot(norm, lightDir), 0.0);\n"
-        "  vec3 diffuse = diff * lightColor;\n"
-        "  float specularStrength = 0.25;\n"
-        "  vec3 viewPos = vec3(0.0, 0.0, 10.0);\n" //TODO make this a uniform
-        "  vec3 viewDir = normalize(viewPos - FragPos);\n"
-        "  vec3 reflectDir = reflect(-lightDir, norm);\n"
-        "  float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);\n"
-        "  vec3 specular = specularStrength * spec * lightColor;\n"
-        "  \n"
-        "  vec3 result = (ambient + diffuse + specular) * objectColor;\n"
-        "  FragColor = vec4(result, 1.0);\n"
-        "}";
-    unsigned int fragmentShader;
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, & fragment_shader_code, NULL);
-    glCompileShader(fragmentShader);
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, & success);
-    if (! success) {
-        char infoLog[512];
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        cout << infoLog << endl;
-        die("fragment shader");
+mesh_ref mesh_arena::alloc(const char * vertices, int nvertices, const char * indices, int nindices, bool wide_indices) {
+    size_t vertex_bytes = nvertices * vertex_stride();
+    int index_size = wide_indices ? 4 : 2;
+    size_t index_bytes = nindices * index_size;
+
+    // released space first, then the end of the buffers
+    size_t vertex_at, index_at;
+    bool reuse_vertices = free_vertices.take(vertex_bytes, vertex_stride(), vertex_at);
+    bool reuse_indices = free_indices.take(index_bytes, index_size, index_at);
+    reserve(reuse_vertices ? 0 : vertex_bytes, reuse_indices ? 0 : index_bytes);
+    if (! reuse_vertices) {
+        vertex_at = vertex_used;
+        vertex_used += vertex_bytes;
     }
+    if (! reuse_indices) {
+        index_used = (index_used + index_size - 1) / index_size * index_size;
+        index_at = index_used;
+        index_used += index_bytes;
+    }
+    mesh_ref ref = {int(index_at / index_size), nindices, int(vertex_at / vertex_stride()), wide_indices, nvertices};
 
-    // shader program
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, & success);
-    if (! success) die("shader program");
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, vertex_at, vertex_bytes, vertices);
+    glBindVertexArray(VAO);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, index_at, index_bytes, indices);
+    return ref;
+}
 
-    // delete shaders (unneeded after program link)
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+void mesh_arena::release(const mesh_ref & mesh) {
+    free_vertices.give(mesh.base_vertex * vertex_stride(), mesh.nvertices * vertex_stride());
+    free_indices.give(mesh.index_offset(), mesh.count * (mesh.wide_indices ? 4 : 2));
 }
 
-rp3d::DynamicsWorld * world;
+mesh_ref mesh_arena::alloc(const mesh_data & mesh) {
+    return alloc(mesh.vertices.data(), mesh.nvertices, mesh.indices.data(), mesh.nindices, mesh.wide_indices);
+}
 
-struct spring {
-    rp3d::RigidBody * from_body;
-    rp3d::Vector3 from_con;
-    rp3d::RigidBody * to_body;
-    rp3d::Vector3 to_con;
-    float strength;
-    float rest_length;
+mesh_arena arena;
 
-    void apply_force();
+// --gpu-extrude keeps just the flat tessellation of each glyph (one cap, 2d
+// positions) and its outline edges on the gpu. the vertex shader makes both
+// caps and the side quads from them at each word's own depth, so thickness
+// is no longer baked into the glyph data
+bool gpu_extrude = false;
+
+// cpu side result for one glyph lod
+struct outline_data {
+    vector<float> cap_vertices; // x, y in ems
+    vector<uint16_t> cap_indices;
+    vector<float> edges;        // from x, y, to x, y in ems, contour order
+
+    size_t bytes() const {
+        return (cap_vertices.size() + edges.size()) * sizeof(float) + cap_indices.size() * sizeof(uint16_t);
+    }
 };
 
-void spring::apply_force() {
-    rp3d::Vector3 from_point = from_con;
-    if (from_body) from_point = from_body->getTransform() * from_con;
+struct outline_ref {
+    int first_index;
+    int count;
+    int base_vertex;
+    int first_edge;
+    int nedges;
+    int nvertices;
 
-    rp3d::Vector3 to_point = to_con;
-    if (to_body) to_point = to_body->getTransform() * to_con;
+    size_t bytes() const { return nvertices * 2 * sizeof(float) + count * sizeof(uint16_t) + nedges * 4 * sizeof(float); }
+};
 
-    rp3d::Vector3 delta = from_point - to_point;
-    rp3d::Vector3 delta_unit = delta.getUnit();
-    float delta_length = delta.length();
-    rp3d::Vector3 force = strength * (delta_length - rest_length) * delta_unit;
+// like mesh_arena, one buffer each for cap vertices, cap indices and edges.
+// the shader reads edges through a buffer texture, by gl_VertexID
+struct outline_arena {
+    GLuint cap_VAO = 0;  // caps: positions and indices
+    GLuint side_VAO = 0; // sides: nothing per vertex
+    GLuint VBO = 0;
+    GLuint IBO = 0;
+    GLuint edge_buffer = 0;
+    GLuint edge_texture = 0;
+    size_t vertex_capacity = 0; // all in bytes
+    size_t vertex_used = 0;
+    size_t index_capacity = 0;
+    size_t index_used = 0;
+    size_t edge_capacity = 0;
+    size_t edge_used = 0;
+    free_list free_vertices;
+    free_list free_indices;
+    free_list free_edges;
+
+    void init(size_t initial_bytes);
+    void bind();
+    outline_ref alloc(const outline_data & outline);
+    void release(const outline_ref & outline);
+};
 
-    if (from_body) from_body->applyForce(-force, from_point);
-    if (to_body) to_body->applyForce(force, to_point);
-}
+void outline_arena::init(size_t initial_bytes) {
+    glGenVertexArrays(1, & cap_VAO);
+    glGenVertexArrays(1, & side_VAO);
+    glGenBuffers(1, & VBO);
+    glGenBuffers(1, & IBO);
+    glGenBuffers(1, & edge_buffer);
+    glGenTextures(1, & edge_texture);
+    vertex_capacity = index_capacity = edge_capacity = initial_bytes;
 
-float word_width(string word) {
-    float width = 0.0;
-    for (char c : word) if (c != '\0') width += Characters[c].advance_x;
-    return width;
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertex_capacity, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, edge_buffer);
+    glBufferData(GL_ARRAY_BUFFER, edge_capacity, nullptr, GL_STATIC_DRAW);
+    glBindVertexArray(cap_VAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_capacity, nullptr, GL_STATIC_DRAW);
+    bind();
 }
 
-float word_height(string word) {
-    float top = -INFINITY;
-    float bot = INFINITY;
-    for (char c : word) {
-        if (c == '\0') continue;
-        Character ch = Characters[c];
-        if (ch.top > top) top = ch.top;
-        if (ch.bot < bot) bot = ch.bot;
-    }
-    return top - bot;
-}
+// after init and whenever a buffer is replaced
+void outline_arena::bind() {
+    glBindVertexArray(cap_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
+    glEnableVertexAttribArray(0);
 
-void draw_letter(Character & ch, glm::mat4 model, glm::vec3 color) {
-    unsigned int modelLoc = glGetUniformLocation(shaderProgram, "model");
-    unsigned int objectColorLoc = glGetUniformLocation(shaderProgram, "objectColor");
+    glBindTexture(GL_TEXTURE_BUFFER, edge_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, edge_buffer);
+}
 
-    glBindVertexArray(ch.VAO);
+outline_ref outline_arena::alloc(const outline_data & outline) {
+    size_t vertex_bytes = outline.cap_vertices.size() * sizeof(float);
+    size_t index_bytes = outline.cap_indices.size() * sizeof(uint16_t);
+    size_t edge_bytes = outline.edges.size() * sizeof(float);
+
+    // released space first, then the end of each buffer
+    bool grown = false;
+    auto place = [&](free_list & released, GLuint & buffer, size_t & used, size_t & capacity, size_t bytes, size_t align) {
+        size_t at;
+        if (released.take(bytes, align, at)) return at;
+        if (used + bytes > capacity) {
+            capacity = max(capacity * 2, used + bytes);
+            buffer = grow_buffer(buffer, used, capacity);
+            grown = true;
+        }
+        at = used;
+        used += bytes;
+        return at;
+    };
+    size_t vertex_at = place(free_vertices, VBO, vertex_used, vertex_capacity, vertex_bytes, 2 * sizeof(float));
+    size_t index_at = place(free_indices, IBO, index_used, index_capacity, index_bytes, sizeof(uint16_t));
+    size_t edge_at = place(free_edges, edge_buffer, edge_used, edge_capacity, edge_bytes, 4 * sizeof(float));
+    if (grown) bind();
+
+    outline_ref ref = {int(index_at / sizeof(uint16_t)), (int) outline.cap_indices.size(),
+                       int(vertex_at / (2 * sizeof(float))),
+                       int(edge_at / (4 * sizeof(float))), int(outline.edges.size() / 4),
+                       int(outline.cap_vertices.size() / 2)};
 
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniform3fv(objectColorLoc, 1, glm::value_ptr(color));
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, vertex_at, vertex_bytes, outline.cap_vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, edge_buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, edge_at, edge_bytes, outline.edges.data());
+    glBindVertexArray(cap_VAO);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, index_at, index_bytes, outline.cap_indices.data());
+    return ref;
+}
 
-    glDrawArrays(GL_TRIANGLES, 0, ch.ntris);
+void outline_arena::release(const outline_ref & outline) {
+    free_vertices.give(outline.base_vertex * 2 * sizeof(float), outline.nvertices * 2 * sizeof(float));
+    free_indices.give(outline.first_index * sizeof(uint16_t), outline.count * sizeof(uint16_t));
+    free_edges.give(outline.first_edge * 4 * sizeof(float), outline.nedges * 4 * sizeof(float));
 }
 
-void draw_word(string word, glm::mat4 base_model, glm::vec3 color) {
-    float x = -word_width(word)/2;
-    for (char c : word) {
-        if (c == '\0') continue;
+outline_arena outlines;
+
+// everything handed to the gpu fresh each frame (instances, indirect
+// commands, the frame graph) goes into one buffer, front to back as each
+// draw list submits. with buffer storage the buffer stays mapped and is split
+// into UPLOAD_REGIONS, one per frame in flight, each fenced when its frame
+// is done; a frame only waits if the gpu is still reading the region it comes
+// back around to. plain 3.3 orphans the buffer each frame instead and writes
+// with glBufferSubData, which the driver can do without stalling
+const int UPLOAD_REGIONS = 3;
+const size_t UPLOAD_ALIGN = 16;
+
+bool persistent_uploads = true; // turned off without buffer storage
+
+struct upload_ring {
+    GLuint buffer = 0;
+    size_t region_size = 0;  // bytes
+    char * mapped = nullptr; // persistent only
+    GLsync fences[UPLOAD_REGIONS] = {};
+    int region = 0;
+    size_t used = 0;         // of this frame's region
+    size_t frame_bytes = 0;
+    size_t peak_bytes = 0;   // most one frame has written
+    long frames = 0;
+    long fence_waits = 0;    // frames that found their region still in use
+    double wait_seconds = 0;
+    long grows = 0;
+
+    void init(size_t bytes_per_frame);
+    void allocate();
+    void grow(size_t bytes);
+    void reserve(size_t bytes);
+    void begin_frame();
+    size_t write(const void * data, size_t bytes);
+    void end_frame();
+};
 
-        Character & ch = Characters[c];
-        auto model = glm::translate(base_model, glm::vec3(x, 0.0f, 0.0f));
-        draw_letter(ch, model, color);
+void upload_ring::init(size_t bytes_per_frame) {
+    persistent_uploads = persistent_uploads && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+    region_size = bytes_per_frame;
+    glGenBuffers(1, & buffer);
+    allocate();
+}
 
-        x += ch.advance_x;
+// storage from buffer storage can't be resized, so a bigger ring is a new
+// buffer. draws already issued from the old one keep it alive on the gpu
+void upload_ring::allocate() {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    if (! persistent_uploads) {
+        glBufferData(GL_COPY_WRITE_BUFFER, region_size, nullptr, GL_STREAM_DRAW);
+        return;
     }
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_COPY_WRITE_BUFFER, region_size * UPLOAD_REGIONS, nullptr, flags);
+    mapped = (char *) glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, region_size * UPLOAD_REGIONS, flags);
+    if (! mapped) die("can't map the upload ring");
 }
 
-struct ext_text {
-    string text;
-    float width;
+// a frame wanted more than a region holds. the rest of it starts over at
+// the front of a new buffer
+void upload_ring::grow(size_t bytes) {
+    region_size = max(region_size * 2, bytes + UPLOAD_ALIGN);
+    grows += 1;
+    if (persistent_uploads) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glDeleteBuffers(1, & buffer);
+        glGenBuffers(1, & buffer);
+        for (GLsync & fence : fences) {
+            if (fence) glDeleteSync(fence);
+            fence = nullptr;
+        }
+        region = 0;
+    }
+    allocate();
+    used = 0;
+}
+
+// room for bytes more, UPLOAD_ALIGN included for each write, so the writes
+// that follow all land in the same buffer
+void upload_ring::reserve(size_t bytes) {
+    if (used + bytes > region_size) grow(bytes);
+}
+
+void upload_ring::begin_frame() {
+    used = 0;
+    frame_bytes = 0;
+    frames += 1;
+    if (! persistent_uploads) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, region_size, nullptr, GL_STREAM_DRAW);
+        return;
+    }
+
+    region = (region + 1) % UPLOAD_REGIONS;
+    GLsync & fence = fences[region];
+    if (! fence) return;
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        stage_timer timer("upload_ring_wait");
+        auto start = chrono::steady_clock::now();
+        fence_waits += 1;
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+        wait_seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+// offset of the data in buffer, which may have changed; bind after writing
+size_t upload_ring::write(const void * data, size_t bytes) {
+    size_t at = (used + UPLOAD_ALIGN - 1) / UPLOAD_ALIGN * UPLOAD_ALIGN;
+    if (at + bytes > region_size) {
+        grow(bytes);
+        at = 0;
+    }
+    used = at + bytes;
+    frame_bytes += bytes;
+
+    if (persistent_uploads) {
+        at += region * region_size;
+        memcpy(mapped + at, data, bytes);
+    } else {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, at, bytes, data);
+    }
+    return at;
+}
+
+void upload_ring::end_frame() {
+    peak_bytes = max(peak_bytes, frame_bytes);
+    if (persistent_uploads) fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+upload_ring uploads;
+
+// per-instance data, read by the vertex shader as instanced attributes. the
+// normal matrix is worked out once per word on the cpu instead of per vertex
+struct instance_data {
+    glm::mat4 model;
+    glm::mat3 normal_matrix;
+    glm::vec3 color;
+};
+
+glm::mat3 normal_matrix(glm::mat4 model) {
+    return glm::transpose(glm::inverse(glm::mat3(model)));
+}
+
+// same layout as the gl indexed indirect draw command
+struct draw_command {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+};
+
+// all instances of one mesh in the current frame
+struct mesh_batch {
+    mesh_ref mesh;
+    vector<instance_data> instances;
+};
+
+// everything drawn in a frame, grouped by mesh on the cpu and submitted as
+// one instanced draw per mesh
+struct draw_list {
+    unordered_map<size_t, int> batch_index; // index offset -> batch
+    vector<mesh_batch> batches;
+    vector<instance_data> instances;
+    vector<draw_command> commands;
+
+    void init();
+    void bind_instances(size_t base);
+    void add(const mesh_ref & mesh, const glm::mat4 & model, const glm::mat3 & normal, glm::vec3 color);
+    void submit();
+};
+
+void draw_list::init() {
+    glBindVertexArray(arena.VAO);
+    for (int ix=2 ; ix<=9 ; ix+=1) {
+        glEnableVertexAttribArray(ix);
+        glVertexAttribDivisor(ix, 1);
+    }
+}
+
+// base is the byte offset in the upload ring of the first instance drawn
+void draw_list::bind_instances(size_t base) {
+    glBindBuffer(GL_ARRAY_BUFFER, uploads.buffer);
+
+    // matrices take one attribute per column
+    for (int col=0 ; col<4 ; col+=1) {
+        glVertexAttribPointer(2 + col, 4, GL_FLOAT, GL_FALSE, sizeof(instance_data),
+                              (void *) (base + offsetof(instance_data, model) + col*sizeof(glm::vec4)));
+    }
+    for (int col=0 ; col<3 ; col+=1) {
+        glVertexAttribPointer(6 + col, 3, GL_FLOAT, GL_FALSE, sizeof(instance_data),
+                              (void *) (base + offsetof(instance_data, normal_matrix) + col*sizeof(glm::vec3)));
+    }
+    glVertexAttribPointer(9, 3, GL_FLOAT, GL_FALSE, sizeof(instance_data),
+                          (void *) (base + offsetof(instance_data, color)));
+}
+
+// batches are keyed by where the mesh's indices start. batches outlive the
+// frame, and an evicted glyph's space can go to another mesh, so the batch
+// takes the mesh it is given
+void draw_list::add(const mesh_ref & mesh, const glm::mat4 & model, const glm::mat3 & normal, glm::vec3 color) {
+    // blanks (space) have no indices and start where the next mesh does, so
+    // they would share its batch and either hide it or draw as it
+    if (mesh.count == 0) return;
+
+    auto it = batch_index.find(mesh.index_offset());
+    if (it == batch_index.end()) {
+        it = batch_index.emplace(mesh.index_offset(), batches.size()).first;
+        batches.push_back({mesh, {}});
+    }
+    batches[it->second].mesh = mesh;
+    batches[it->second].instances.push_back({model, normal, color});
+}
+
+// one multi-draw per index width where the driver has it, otherwise one
+// instanced draw per mesh
+void draw_list::submit() {
+    int nnarrow = 0;
+    for (int wide=0 ; wide<2 ; wide+=1) {
+        for (mesh_batch & batch : batches) {
+            if (batch.instances.empty() || batch.mesh.wide_indices != (bool) wide) continue;
+            commands.push_back({(GLuint) batch.mesh.count, (GLuint) batch.instances.size(),
+                                (GLuint) batch.mesh.first_index, batch.mesh.base_vertex,
+                                (GLuint) instances.size()});
+            instances.insert(instances.end(), batch.instances.begin(), batch.instances.end());
+            batch.instances.clear();
+        }
+        if (! wide) nnarrow = commands.size();
+    }
+
+    if (commands.empty()) return;
+
+    glBindVertexArray(arena.VAO);
+
+    size_t command_bytes = commands.size() * sizeof(draw_command);
+    size_t instance_bytes = instances.size() * sizeof(instance_data);
+    uploads.reserve(command_bytes + instance_bytes + 2 * UPLOAD_ALIGN);
+    size_t command_at = multi_draw_indirect ? uploads.write(commands.data(), command_bytes) : 0;
+    size_t instance_at = uploads.write(instances.data(), instance_bytes);
+
+    if (multi_draw_indirect) {
+        bind_instances(instance_at);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, uploads.buffer);
+        if (nnarrow > 0) {
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (void *) command_at, nnarrow, 0);
+        }
+        if ((int) commands.size() > nnarrow) {
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                        (void *) (command_at + nnarrow * sizeof(draw_command)),
+                                        commands.size() - nnarrow, 0);
+        }
+    } else {
+        for (int ix=0 ; ix<(int) commands.size() ; ix+=1) {
+            draw_command & cmd = commands[ix];
+            bool wide = ix >= nnarrow;
+            bind_instances(instance_at + cmd.base_instance * sizeof(instance_data));
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, cmd.count,
+                    wide ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT,
+                    (void *) (size_t) (cmd.first_index * (wide ? 4 : 2)),
+                    cmd.instance_count, cmd.base_vertex);
+        }
+    }
+
+    instances.clear();
+    commands.clear();
+}
+
+draw_list frame_draws;
+
+// --gpu-extrude letters, instance_data plus the depth to extrude to
+struct extrude_instance {
+    glm::mat4 model;
+    glm::mat3 normal_matrix;
+    glm::vec3 color;
+    float depth;
+};
+
+struct extrude_batch {
+    outline_ref outline;
+    vector<extrude_instance> instances;
+};
+
+// grouped by glyph like draw_list. caps draw every letter twice, front then
+// back, so their instance attributes advance every second instance
+struct extrude_draw_list {
+    GLuint program = 0;
+    GLint projection_loc;
+    GLint view_loc;
+    GLint light_pos_loc;
+    GLint light_color_loc;
+    GLint sides_loc;
+    unordered_map<int, int> batch_index; // first edge -> batch
+    vector<extrude_batch> batches;
+    vector<extrude_instance> instances;
+
+    void init();
+    void bind_instances(GLuint VAO, size_t base);
+    void add(const outline_ref & outline, const glm::mat4 & model, const glm::mat3 & normal, glm::vec3 color, float depth);
+    void submit(const glm::mat4 & projection, const glm::mat4 & view);
+};
+
+GLuint load_program(string vertex_file, string fragment_file, string cache_name, bool & cached);
+
+void extrude_draw_list::init() {
+    bool cached;
+    program = load_program("text3d_extrude.vert", "text3d.frag", "text3d_extrude.progbin", cached);
+    projection_loc = glGetUniformLocation(program, "projection");
+    view_loc = glGetUniformLocation(program, "view");
+    light_pos_loc = glGetUniformLocation(program, "lightPos");
+    light_color_loc = glGetUniformLocation(program, "lightColor");
+    sides_loc = glGetUniformLocation(program, "sides");
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "edges"), 1);
+
+    GLuint VAOs[2] = {outlines.cap_VAO, outlines.side_VAO};
+    for (int v=0 ; v<2 ; v+=1) {
+        glBindVertexArray(VAOs[v]);
+        for (int ix=2 ; ix<=10 ; ix+=1) {
+            glEnableVertexAttribArray(ix);
+            glVertexAttribDivisor(ix, v == 0 ? 2 : 1);
+        }
+    }
+}
+
+// without base instance, each batch points the attributes at its own
+// instances, base bytes into the upload ring
+void extrude_draw_list::bind_instances(GLuint VAO, size_t base) {
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, uploads.buffer);
+    for (int col=0 ; col<4 ; col+=1) {
+        glVertexAttribPointer(2 + col, 4, GL_FLOAT, GL_FALSE, sizeof(extrude_instance),
+                              (void *) (base + offsetof(extrude_instance, model) + col*sizeof(glm::vec4)));
+    }
+    for (int col=0 ; col<3 ; col+=1) {
+        glVertexAttribPointer(6 + col, 3, GL_FLOAT, GL_FALSE, sizeof(extrude_instance),
+                              (void *) (base + offsetof(extrude_instance, normal_matrix) + col*sizeof(glm::vec3)));
+    }
+    glVertexAttribPointer(9, 3, GL_FLOAT, GL_FALSE, sizeof(extrude_instance),
+                          (void *) (base + offsetof(extrude_instance, color)));
+    glVertexAttribPointer(10, 1, GL_FLOAT, GL_FALSE, sizeof(extrude_instance),
+                          (void *) (base + offsetof(extrude_instance, depth)));
+}
+
+void extrude_draw_list::add(const outline_ref & outline, const glm::mat4 & model, const glm::mat3 & normal, glm::vec3 color, float depth) {
+    if (outline.nedges == 0) return; // blank
+    auto it = batch_index.find(outline.first_edge);
+    if (it == batch_index.end()) {
+        it = batch_index.emplace(outline.first_edge, batches.size()).first;
+        batches.push_back({outline, {}});
+    }
+    batches[it->second].outline = outline;
+    batches[it->second].instances.push_back({model, normal, color, depth});
+}
+
+void extrude_draw_list::submit(const glm::mat4 & projection, const glm::mat4 & view) {
+    vector<int> firsts;
+    for (extrude_batch & batch : batches) {
+        firsts.push_back(instances.size());
+        instances.insert(instances.end(), batch.instances.begin(), batch.instances.end());
+    }
+    if (instances.empty()) return;
+
+    glUseProgram(program);
+    glUniformMatrix4fv(projection_loc, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniformMatrix4fv(view_loc, 1, GL_FALSE, glm::value_ptr(view));
+    glUniform3f(light_pos_loc, 1.0, 1.0, -1.0);
+    glUniform3f(light_color_loc, 1.0, 1.0, 1.0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, outlines.edge_texture);
+    glActiveTexture(GL_TEXTURE0);
+
+    size_t instance_at = uploads.write(instances.data(), instances.size() * sizeof(extrude_instance));
+
+    glUniform1i(sides_loc, 0);
+    for (size_t b=0 ; b<batches.size() ; b+=1) {
+        const extrude_batch & batch = batches[b];
+        if (batch.instances.empty() || batch.outline.count == 0) continue;
+        bind_instances(outlines.cap_VAO, instance_at + firsts[b] * sizeof(extrude_instance));
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, batch.outline.count, GL_UNSIGNED_SHORT,
+                (void *) (size_t) (batch.outline.first_index * sizeof(uint16_t)),
+                2 * batch.instances.size(), batch.outline.base_vertex);
+    }
+
+    // gl_VertexID counts from first, which picks out the glyph's edges
+    glUniform1i(sides_loc, 1);
+    for (size_t b=0 ; b<batches.size() ; b+=1) {
+        extrude_batch & batch = batches[b];
+        if (batch.instances.empty()) continue;
+        bind_instances(outlines.side_VAO, instance_at + firsts[b] * sizeof(extrude_instance));
+        glDrawArraysInstanced(GL_TRIANGLES, batch.outline.first_edge * 6, batch.outline.nedges * 6,
+                              batch.instances.size());
+        batch.instances.clear();
+    }
+
+    instances.clear();
+}
+
+extrude_draw_list extrude_draws;
+
+struct aabb {
+    glm::vec3 lo = glm::vec3(INFINITY);
+    glm::vec3 hi = glm::vec3(-INFINITY);
+
+    void add(glm::vec3 p) {
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    void add(const aabb & box) {
+        lo = glm::min(lo, box.lo);
+        hi = glm::max(hi, box.hi);
+    }
+    glm::vec3 center() const { return (lo + hi) * 0.5f; }
+    glm::vec3 extent() const { return (hi - lo) * 0.5f; }
+    aabb transformed(const glm::mat4 & m) const;
+};
+
+// the box around this box after an affine transform
+aabb aabb::transformed(const glm::mat4 & m) const {
+    glm::vec3 c = center();
+    glm::vec3 e = extent();
+    aabb out;
+    for (int row=0 ; row<3 ; row+=1) {
+        float wc = m[3][row];
+        float we = 0;
+        for (int col=0 ; col<3 ; col+=1) {
+            wc += m[col][row] * c[col];
+            we += fabs(m[col][row]) * e[col];
+        }
+        out.lo[row] = wc - we;
+        out.hi[row] = wc + we;
+    }
+    return out;
+}
+
+// planes of the view volume, pointing inwards, from the rows of the
+// view-projection matrix
+struct frustum {
+    glm::vec4 planes[6];
+
+    frustum(const glm::mat4 & view_projection);
+    bool visible(const aabb & box) const;
+};
+
+frustum::frustum(const glm::mat4 & m) {
+    for (int axis=0 ; axis<3 ; axis+=1) {
+        for (int side=0 ; side<2 ; side+=1) {
+            float sign = side ? -1 : 1;
+            glm::vec4 & plane = planes[2*axis + side];
+            for (int col=0 ; col<4 ; col+=1) plane[col] = m[col][3] + sign * m[col][axis];
+        }
+    }
+}
+
+// false only when the box is entirely outside some plane
+bool frustum::visible(const aabb & box) const {
+    glm::vec3 c = box.center();
+    glm::vec3 e = box.extent();
+    for (const glm::vec4 & p : planes) {
+        float distance = p[0]*c[0] + p[1]*c[1] + p[2]*c[2] + p[3];
+        float radius = fabs(p[0])*e[0] + fabs(p[1])*e[1] + fabs(p[2])*e[2];
+        if (distance + radius < 0) return false;
+    }
+    return true;
+}
+
+// per frame counts, reset by draw_scene. totals are summed over the run
+struct scene_stats {
+    long words_drawn = 0;
+    long words_culled = 0;
+    long words_sdf = 0; // of those drawn
+    long teapots_culled = 0;
+
+    void add(const scene_stats & frame) {
+        words_drawn += frame.words_drawn;
+        words_culled += frame.words_culled;
+        words_sdf += frame.words_sdf;
+        teapots_culled += frame.teapots_culled;
+    }
+};
+
+scene_stats stats;
+scene_stats stats_total;
+
+mesh_ref teapot_mesh;
+aabb teapot_bounds; // mesh space
+rp3d::RigidBody * teapot_body;
+
+int teapot_fineness = 10;
+void load_teapot() {
+    // load teapot bezier patch control points
+    vector<bezier_patch> patches = {};
+    load_patches("teapotCGA.bpt", patches);
+
+    // convert bezier patches to triangle meshes
+    const int tf = teapot_fineness;
+    vector<float> coords = {};
+    vector<uint32_t> triangles = {};
+    vector<glm::vec3> points;
+    vector<glm::vec3> normals;
+    for (auto & patch : patches) {
+        //TODO make sure uv coordinates match (important?)
+        evaluate_patch(patch, tf, points, normals);
+
+        uint32_t base = coords.size() / SOUP_FLOATS;
+        for (int ix=0 ; ix<tf*tf ; ix+=1) {
+            add_point(coords, points[ix]);
+            teapot_bounds.add(points[ix]);
+            add_point(coords, normals[ix]);
+        }
+
+        for (int ix=0 ; ix<tf-1 ; ix+=1) {
+            for (int jx=0 ; jx<tf-1 ; jx+=1) {
+                uint32_t p = base + ix*tf + jx;
+                triangles.insert(triangles.end(), {p, p+1, p+tf});
+                triangles.insert(triangles.end(), {p+tf+1, p+tf, p+1});
+            }
+        }
+    }
+
+    mesh_data mesh;
+    build_mesh(coords, triangles, mesh);
+    report_mesh_bytes("teapot", 1, triangles.size(), mesh.bytes());
+    teapot_mesh = arena.alloc(mesh);
+}
+
+GLuint shaderProgram;
+
+int teapot_pose;
+glm::mat4 body_model(int pose_index);
+
+// mesh space to body space
+glm::mat4 teapot_model() {
+    auto model = glm::mat4(1.0f);
+    model = glm::scale(model, glm::vec3(0.5, 0.5, 0.5));
+    model = glm::translate(model, glm::vec3(0, -2, 0));
+    model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1, 0, 0));
+    //model = glm::rotate(model, glm::radians(-15.0f), glm::vec3(0, 0, 1));
+    return model;
+}
+
+void draw_teapot(const frustum & view) {
+    glm::mat4 model = body_model(teapot_pose) * teapot_model();
+
+    if (! view.visible(teapot_bounds.transformed(model))) {
+        stats.teapots_culled += 1;
+        return;
+    }
+
+    glm::vec3 color = {1.0, 1.0, 1.0};
+
+    frame_draws.add(teapot_mesh, model, normal_matrix(model), color);
+}
+
+// polylines of one glyph outline, with curves flattened until no chord is
+// further than tolerance (in font units) from the curve. stored flat, each
+// contour runs from its start to the next one's. a counting pass first
+// sizes the storage exactly
+struct outline_sink {
+    scratch_vector<glm::vec3> points;
+    scratch_vector<int> starts;
+    float tolerance;
+    bool counting = false;
+    int npoints = 0;
+    int ncontours = 0;
+    glm::vec3 last;
+
+    outline_sink(arena_allocator<char> alloc) : points(alloc), starts(alloc) {}
+    int contour_end(int contour) const {
+        return contour+1 < (int) starts.size() ? starts[contour+1] : points.size();
+    }
+};
+
+void outline_point(outline_sink * sink, glm::vec3 point) {
+    if (sink->counting) sink->npoints += 1;
+    else sink->points.push_back(point);
+    sink->last = point;
+}
+
+// TODO move divide by font_size into pl_funcs
+int pl_moveto(const FT_Vector * FT_to, void * user) {
+    auto * sink = (outline_sink *) user;
+    if (sink->counting) sink->ncontours += 1;
+    else sink->starts.push_back(sink->points.size());
+    outline_point(sink, {FT_to->x, FT_to->y, 0.0});
+    return 0;
+}
+
+int pl_lineto(const FT_Vector * FT_to, void * user) {
+    outline_point((outline_sink *) user, {FT_to->x, FT_to->y, 0.0});
+    return 0;
+}
+
+// chords of a curve split into n equal steps in t stray at most
+// max|B''| / (8 n^2) from it
+const int MAX_SEGMENTS = 64;
+
+int bezier_segments(float max_second_derivative, float tolerance) {
+    int n = ceil(sqrt(max_second_derivative / (8 * tolerance)));
+    return min(max(n, 1), MAX_SEGMENTS);
+}
+
+int pl_conicto(const FT_Vector * FT_ctl, const FT_Vector * FT_to, void * user) {
+    auto * sink = (outline_sink *) user;
+
+    glm::vec3 from = sink->last;
+    glm::vec3 ctl = {FT_ctl->x, FT_ctl->y, 0.0};
+    glm::vec3 to = {FT_to->x, FT_to->y, 0.0};
+
+    int nsegments = bezier_segments(2 * glm::length(from - 2.0f*ctl + to), sink->tolerance);
+    for (int ix=1 ; ix<nsegments ; ix+=1) {
+        float t = ix / float(nsegments);
+        float s = 1 - t;
+        outline_point(sink, s*s * from + 2*s*t * ctl + t*t * to);
+    }
+    outline_point(sink, to);
+    return 0;
+}
+
+int pl_cubicto(const FT_Vector * FT_ctl1, const FT_Vector * FT_ctl2,
+            const FT_Vector * FT_to, void * user) {
+    auto * sink = (outline_sink *) user;
+
+    glm::vec3 from = sink->last;
+    glm::vec3 ctl1 = {FT_ctl1->x, FT_ctl1->y, 0.0};
+    glm::vec3 ctl2 = {FT_ctl2->x, FT_ctl2->y, 0.0};
+    glm::vec3 to = {FT_to->x, FT_to->y, 0.0};
+
+    float bend = max(glm::length(from - 2.0f*ctl1 + ctl2), glm::length(ctl1 - 2.0f*ctl2 + to));
+    int nsegments = bezier_segments(6 * bend, sink->tolerance);
+    for (int ix=1 ; ix<nsegments ; ix+=1) {
+        float t = ix / float(nsegments);
+        float s = 1 - t;
+        outline_point(sink, s*s*s * from + 3*s*s*t * ctl1 + 3*s*t*t * ctl2
+                            + t*t*t * to);
+    }
+    outline_point(sink, to);
+    return 0;
+}
+
+FT_Outline_Funcs pl_funcs = {& pl_moveto, & pl_lineto,
+                             & pl_conicto, & pl_cubicto,
+                             0, 0};
+
+const char FONT_FILE[] = "georgiab.ttf";
+const int NGLYPHS = 127; // char 127 hangs for some reason
+
+// fonts in use, by file. font 0 is FONT_FILE, the only one preloaded, cached
+// on disk and in the sdf atlas; config words can name others, whose glyphs
+// are all tessellated on first use. ids are handed out on the context thread
+// before any request for them is queued, and never change after
+const int MAX_FONTS = 16;
+string font_files[MAX_FONTS] = {FONT_FILE};
+int nfonts = 1;
+
+// glyphs are known by font and codepoint together
+typedef uint64_t glyph_key;
+
+glyph_key key_of(int font, char32_t c) {
+    return (uint64_t) font << 32 | c;
+}
+
+// ascii is tessellated up front (and cached), everything else on first use.
+// the last preloaded mesh is the font's .notdef box, drawn as a placeholder
+// until a glyph's own mesh is ready
+const int NPRELOAD = NGLYPHS + 1;
+
+const float THICKNESS = 0.25;
+
+// every glyph is tessellated at a few flattening tolerances (in ems), coarse
+// to fine. a word draws with the coarsest one whose error stays under
+// MAX_PIXEL_ERROR at its projected size
+const int NLODS = 3;
+const float LOD_TOLERANCE[NLODS] = {0.02, 0.004, 0.001};
+const float MAX_PIXEL_ERROR = 1.0;
+
+// --bake-words merges each config word into one mesh, which needs a cpu copy
+// of every glyph mesh to build from
+bool bake_words = false;
+
+// metrics are in ems from the pen position on the baseline; left/right and
+// top/bot are the ink box. ready once the metrics are known, which outlives
+// the meshes being evicted
+struct Character {
+    float advance_x = 0;
+    float left = 0;
+    float right = 0;
+    float top = 0;
+    float bot = 0;
+    mesh_ref lods[NLODS];
+    mesh_data source[NLODS]; // only kept for --bake-words
+    outline_ref outlines[NLODS]; // instead of lods with --gpu-extrude
+    bool ready = false;
+    bool resident = false;   // lods or outlines are on the gpu
+    bool requested = false;  // queued with the loader
+    size_t bytes = 0;        // gpu memory of every lod
+    int last_drawn = 0;      // glyph_clock
+};
+
+unordered_map<glyph_key, Character> Characters;
+Character placeholder;
+
+Character & preloaded_glyph(int ix) {
+    return ix < NGLYPHS ? Characters[key_of(0, ix)] : placeholder;
+}
+
+// --glyph-budget caps the gpu memory of glyph meshes. over it, the glyphs
+// drawn longest ago give their meshes back, and are tessellated again if
+// they come back into view. the placeholder is never evicted
+size_t glyph_budget = 0; // bytes, 0 for no limit
+int glyph_clock = 0;     // frames
+
+struct glyph_counters {
+    long hits = 0;       // lookups that found the meshes resident
+    long misses = 0;     // lookups that got the placeholder
+    long evictions = 0;
+    size_t resident_bytes = 0;
+    size_t peak_bytes = 0;
+};
+
+glyph_counters glyph_stats;
+
+void make_resident(Character & ch) {
+    ch.bytes = 0;
+    for (int lod=0 ; lod<NLODS ; lod+=1) ch.bytes += gpu_extrude ? ch.outlines[lod].bytes() : ch.lods[lod].bytes();
+    ch.ready = true;
+    ch.resident = true;
+    ch.requested = false;
+    glyph_stats.resident_bytes += ch.bytes;
+    glyph_stats.peak_bytes = max(glyph_stats.peak_bytes, glyph_stats.resident_bytes);
+}
+
+void evict(Character & ch) {
+    for (int lod=0 ; lod<NLODS ; lod+=1) {
+        if (gpu_extrude) outlines.release(ch.outlines[lod]);
+        else arena.release(ch.lods[lod]);
+    }
+    ch.resident = false;
+    glyph_stats.resident_bytes -= ch.bytes;
+    glyph_stats.evictions += 1;
+}
+
+// least recently drawn first, down to the budget. glyphs drawn last frame
+// will most likely be drawn again this one, so they stay even over budget
+void evict_glyphs() {
+    if (glyph_budget == 0 || glyph_stats.resident_bytes <= glyph_budget) return;
+
+    vector<Character *> idle;
+    for (auto & item : Characters) {
+        Character & ch = item.second;
+        if (ch.resident && ch.last_drawn < glyph_clock - 1) idle.push_back(& ch);
+    }
+    sort(idle.begin(), idle.end(), [](Character * a, Character * b) { return a->last_drawn < b->last_drawn; });
+    for (Character * ch : idle) {
+        if (glyph_stats.resident_bytes <= glyph_budget) break;
+        evict(*ch);
+    }
+}
+
+void report_glyph_residency() {
+    cout << "glyphs: " << glyph_stats.hits << " hits, " << glyph_stats.misses << " misses, "
+         << glyph_stats.evictions << " evictions, " << glyph_stats.resident_bytes / 1024 << " KB resident (peak "
+         << glyph_stats.peak_bytes / 1024 << " KB";
+    if (glyph_budget) cout << ", budget " << glyph_budget / 1024 << " KB";
+    cout << ")" << endl;
+}
+
+FT_UInt preloaded_glyph_index(FT_Face face, int ix) {
+    return ix < NGLYPHS ? FT_Get_Char_Index(face, ix) : 0;
+}
+
+// cpu side result of tessellating one glyph
+struct glyph_mesh {
+    float advance_x = 0;
+    float left = 0;
+    float right = 0;
+    float top = 0;
+    float bot = 0;
+    mesh_data lods[NLODS];
+    outline_data outlines[NLODS]; // instead of lods with --gpu-extrude
+};
+
+// --no-glyph-arena puts glyph scratch memory back on the heap, for comparison
+bool glyph_arena = true;
+
+// libtess2 allocation hooks. the arena ones keep each block's size in front
+// of it so realloc knows how much to copy
+const size_t TESS_HEADER = alignof(max_align_t);
+
+void * tess_arena_alloc(void * user, unsigned int size) {
+    char * p = (char *) ((bump_arena *) user)->alloc(size + TESS_HEADER);
+    *(unsigned int *) p = size;
+    return p + TESS_HEADER;
+}
+
+void * tess_arena_realloc(void * user, void * ptr, unsigned int size) {
+    void * q = tess_arena_alloc(user, size);
+    if (ptr) memcpy(q, ptr, min(size, *(unsigned int *) ((char *) ptr - TESS_HEADER)));
+    return q;
+}
+
+void tess_arena_free(void * user, void * ptr) {}
+
+void * tess_heap_alloc(void * user, unsigned int size) { return counted_malloc(size); }
+void * tess_heap_realloc(void * user, void * ptr, unsigned int size) { return counted_realloc(ptr, size); }
+void tess_heap_free(void * user, void * ptr) { counted_free(ptr); }
+
+// totals over every worker so far
+atomic<long> arena_allocations{0};
+atomic<long> arena_peak{0};
+
+// per-thread tessellation state; freetype faces and tesselators must not be
+// shared between threads. with the arena, all scratch memory for an outline
+// comes from it and is dropped in one go before the next
+struct glyph_worker {
+    FT_Library ft;
+    FT_Face faces[MAX_FONTS] = {}; // opened as they are needed
+    FT_Face face;                  // the one in use, font 0 to begin with
+    bump_arena arena;
+    TESSalloc tess_alloc;
+    TESStesselator * tess = nullptr; // kept from outline to outline on the heap
+
+    glyph_worker();
+    ~glyph_worker();
+    void use_font(int font);
+};
+
+glyph_worker::glyph_worker() {
+    if (FT_Init_FreeType(& ft)) die("freetype");
+    use_font(0);
+
+    memset(& tess_alloc, 0, sizeof(tess_alloc));
+    if (glyph_arena) {
+        tess_alloc.memalloc = tess_arena_alloc;
+        tess_alloc.memrealloc = tess_arena_realloc;
+        tess_alloc.memfree = tess_arena_free;
+        tess_alloc.userData = & arena;
+    } else {
+        tess_alloc.memalloc = tess_heap_alloc;
+        tess_alloc.memrealloc = tess_heap_realloc;
+        tess_alloc.memfree = tess_heap_free;
+        tess = tessNewTess(& tess_alloc);
+        if (! tess) die("tesselator");
+        tessSetOption(tess, TESS_CONSTRAINED_DELAUNAY_TRIANGULATION, 1);
+    }
+}
+
+glyph_worker::~glyph_worker() {
+    if (tess) tessDeleteTess(tess); // for some reason not deleting kills rp3d, shrug
+    for (FT_Face f : faces) if (f) FT_Done_Face(f);
+    FT_Done_FreeType(ft);
+
+    arena_allocations += arena.nallocs;
+    long peak = arena_peak.load();
+    while ((long) arena.peak > peak && ! arena_peak.compare_exchange_weak(peak, arena.peak)) {}
+}
+
+void glyph_worker::use_font(int font) {
+    if (! faces[font] && FT_New_Face(ft, font_files[font].c_str(), 0, & faces[font])) die("font " + font_files[font]);
+    face = faces[font];
+}
+
+// mesh the glyph loaded in w.face, flattened to tolerance ems. with flat,
+// just the one cap and the outline edges go there and mesh is left alone
+void tessellate_outline(glyph_worker & w, float tolerance, mesh_data & mesh, outline_data * flat = nullptr) {
+    float font_size = w.face->units_per_EM;
+    bump_arena * scratch = glyph_arena ? & w.arena : nullptr;
+    if (scratch) scratch->reset();
+
+    // decompose glyph to polyline, counting first so nothing grows
+    FT_Outline outline = w.face->glyph->outline;
+    outline_sink sink(scratch);
+    sink.tolerance = tolerance * font_size;
+    sink.counting = true;
+    FT_Outline_Decompose(& outline, & pl_funcs, (void *) & sink);
+    sink.points.reserve(sink.npoints);
+    sink.starts.reserve(sink.ncontours);
+    sink.counting = false;
+    FT_Outline_Decompose(& outline, & pl_funcs, (void *) & sink);
+    int ncontours = sink.starts.size();
+
+    // mesh polylines to triangles (both front and back face). on the arena
+    // the tesselator lives and dies with the outline
+    TESStesselator * tobj = w.tess;
+    if (scratch) {
+        tobj = tessNewTess(& w.tess_alloc);
+        if (! tobj) die("tesselator");
+        tessSetOption(tobj, TESS_CONSTRAINED_DELAUNAY_TRIANGULATION, 1);
+    }
+
+    for (int contour=0 ; contour<ncontours ; contour+=1) {
+        int start = sink.starts[contour];
+        tessAddContour(tobj, 3, & sink.points[start], 3*sizeof(float), sink.contour_end(contour) - start);
+    }
+    // an empty glyph leaves the previous glyph's element count behind
+    bool tesselated = tessTesselate(tobj, TESS_WINDING_ODD, TESS_POLYGONS, 3, 3, nullptr);
+    int nelems = tesselated ? tessGetElementCount(tobj) : 0;
+
+    if (flat) {
+        const float * verts = tessGetVertices(tobj);
+        const int * elems = tessGetElements(tobj);
+        int nverts = tesselated ? tessGetVertexCount(tobj) : 0;
+        if (nverts > 0xffff) die("glyph outline too detailed");
+        for (int ix=0 ; ix<nverts ; ix+=1) {
+            flat->cap_vertices.push_back(verts[ix*3] / font_size);
+            flat->cap_vertices.push_back(verts[ix*3+1] / font_size);
+        }
+        for (int ix=0 ; ix<nelems*3 ; ix+=1) flat->cap_indices.push_back(elems[ix]);
+
+        for (int contour=0 ; contour<ncontours ; contour+=1) {
+            int start = sink.starts[contour];
+            int end = sink.contour_end(contour);
+            glm::vec3 prev_point = sink.points[end-1];
+            for (int ix=start ; ix<end ; ix+=1) {
+                glm::vec3 point = sink.points[ix];
+                if (point != prev_point) {
+                    flat->edges.insert(flat->edges.end(), {prev_point.x / font_size, prev_point.y / font_size,
+                                                           point.x / font_size, point.y / font_size});
+                }
+                prev_point = point;
+            }
+        }
+        return;
+    }
+
+    // front, back and two side triangles per outline point, written straight
+    // into a buffer of exactly that size
+    int nvertices = nelems*3 * 2 + sink.points.size() * 6;
+    scratch_vector<float> vertices(nvertices * SOUP_FLOATS, 0.0f, scratch);
+    float * front = vertices.data();
+    float * back = front + nelems*3 * SOUP_FLOATS;
+    float * side = back + nelems*3 * SOUP_FLOATS;
+    auto put = [](float * & out, glm::vec3 point, glm::vec3 normal) {
+        *out++ = point.x;
+        *out++ = point.y;
+        *out++ = point.z;
+        *out++ = normal.x;
+        *out++ = normal.y;
+        *out++ = normal.z;
+    };
+
+    glm::vec3 z(0, 0, THICKNESS/2);
+    glm::vec3 norm(0, 0, -1);
+
+    const float * verts = tessGetVertices(tobj);
+    const int * elems = tessGetElements(tobj);
+    for (int ix=0 ; ix<nelems ; ix+=1) {
+        const int * p = & elems[ix * 3];
+        for (int j=0 ; j<3 ; j+=1) {
+            glm::vec3 point = {verts[p[j]*3]/font_size, verts[p[j]*3+1]/font_size, 0};
+            put(front, point-z, norm);
+            put(back, point+z, -norm);
+        }
+    }
+
+    // add sides
+    float font_ratio = 1/font_size;
+    auto half_deep = glm::vec3(0,0,THICKNESS/2);
+    for (int contour=0 ; contour<ncontours ; contour+=1) {
+        int start = sink.starts[contour];
+        int end = sink.contour_end(contour);
+        auto prev_point = sink.points[end-1];
+        for (int ix=start ; ix<end ; ix+=1) {
+            glm::vec3 point = sink.points[ix];
+            //TODO blend normals between adjacent faces
+            glm::vec3 normal = glm::triangleNormal(
+                    prev_point * font_ratio - half_deep,
+                    point * font_ratio + half_deep,
+                    point * font_ratio - half_deep
+            );
+
+            put(side, point * font_ratio + half_deep, normal);
+            put(side, prev_point * font_ratio - half_deep, normal);
+            put(side, point * font_ratio - half_deep, normal);
+
+            put(side, point * font_ratio + half_deep, normal);
+            put(side, prev_point * font_ratio + half_deep, normal);
+            put(side, prev_point * font_ratio - half_deep, normal);
+
+            prev_point = point;
+        }
+    }
+
+    build_mesh(vertices.data(), nvertices, nullptr, 0, mesh, scratch);
+}
+
+void tessellate_glyph(glyph_worker & w, FT_UInt glyph_index, glyph_mesh & mesh) {
+    if (FT_Load_Glyph(w.face, glyph_index, FT_LOAD_NO_SCALE)) die("glyph");
+
+    for (int lod=0 ; lod<NLODS ; lod+=1) {
+        tessellate_outline(w, LOD_TOLERANCE[lod], mesh.lods[lod], gpu_extrude ? & mesh.outlines[lod] : nullptr);
+    }
+
+    float font_size = w.face->units_per_EM;
+    const FT_Glyph_Metrics & m = w.face->glyph->metrics;
+    mesh.advance_x = w.face->glyph->advance.x / font_size;
+    mesh.left = m.horiBearingX / font_size;
+    mesh.right = (m.horiBearingX + m.width) / font_size;
+    mesh.top = m.horiBearingY / font_size;
+    mesh.bot = (m.horiBearingY - m.height) / font_size;
+}
+
+// send triangles to opengl
+void upload_glyph(Character & ch, const glyph_mesh & mesh) {
+    ch.advance_x = mesh.advance_x;
+    ch.left = mesh.left;
+    ch.right = mesh.right;
+    ch.top = mesh.top;
+    ch.bot = mesh.bot;
+    for (int lod=0 ; lod<NLODS ; lod+=1) {
+        if (gpu_extrude) {
+            ch.outlines[lod] = outlines.alloc(mesh.outlines[lod]);
+            continue;
+        }
+        ch.lods[lod] = arena.alloc(mesh.lods[lod]);
+        if (bake_words) ch.source[lod] = mesh.lods[lod];
+    }
+    make_resident(ch);
+}
+
+// read-only memory map of a whole file
+struct mapped_file {
+    const char * data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#endif
+
+    bool open(string filename);
+    void close();
+    ~mapped_file() { close(); }
+};
+
+#ifdef _WIN32
+bool mapped_file::open(string filename) {
+    file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER filesize;
+    if (! GetFileSizeEx(file, & filesize) || filesize.QuadPart == 0) {
+        close();
+        return false;
+    }
+    size = filesize.QuadPart;
+
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping) data = (const char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (! data) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void mapped_file::close() {
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    data = nullptr;
+    size = 0;
+    mapping = NULL;
+    file = INVALID_HANDLE_VALUE;
+}
+#else
+bool mapped_file::open(string filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, & st) < 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void * p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps its own reference
+    if (p == MAP_FAILED) return false;
+
+    data = (const char *) p;
+    size = st.st_size;
+    return true;
+}
+
+void mapped_file::close() {
+    if (data) munmap((void *) data, size);
+    data = nullptr;
+    size = 0;
+}
+#endif
+
+void report_glyph_bytes(int nglyphs, size_t soup_vertices[NLODS], size_t bytes[NLODS]) {
+    for (int lod=0 ; lod<NLODS ; lod+=1) {
+        report_mesh_bytes("glyphs lod " + to_string(lod), nglyphs, soup_vertices[lod], bytes[lod]);
+    }
+}
+
+// on-disk glyph mesh cache
+//
+// layout: header, one entry per glyph lod, then the packed vertex and index
+// data of every lod exactly as it goes into the arena.
+// everything that changes the tessellation output goes into the header so a
+// cache built with other settings is treated as stale and rebuilt
+const char GLYPH_CACHE_MAGIC[8] = {'t','e','x','t','3','d','g','c'};
+const uint32_t GLYPH_CACHE_VERSION = 6;
+
+struct glyph_cache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t nglyphs;
+    uint64_t font_hash;
+    float thickness;
+    int32_t nlods;
+    float lod_tolerance[NLODS];
+    int32_t half_positions;
+    uint64_t payload_size;
+    uint64_t payload_hash;
+};
+
+struct glyph_cache_entry {
+    float advance_x;
+    float left;
+    float right;
+    float top;
+    float bot;
+    uint32_t nvertices;
+    uint32_t nindices;
+    uint32_t wide_indices;
+    uint64_t vertex_offset; // in bytes from the end of the entries
+    uint64_t index_offset;
+};
+
+glyph_cache_header glyph_cache_key(uint64_t font_hash) {
+    glyph_cache_header h;
+    memset(& h, 0, sizeof(h));
+    memcpy(h.magic, GLYPH_CACHE_MAGIC, sizeof(h.magic));
+    h.version = GLYPH_CACHE_VERSION;
+    h.nglyphs = NPRELOAD;
+    h.font_hash = font_hash;
+    h.thickness = THICKNESS;
+    h.nlods = NLODS;
+    for (int lod=0 ; lod<NLODS ; lod+=1) h.lod_tolerance[lod] = LOD_TOLERANCE[lod];
+    h.half_positions = half_positions;
+    return h;
+}
+
+// returns false if the cache is missing, stale or corrupt
+bool load_glyph_cache(string filename, uint64_t font_hash) {
+    mapped_file cache;
+    if (! cache.open(filename)) return false;
+    if (cache.size < sizeof(glyph_cache_header)) return false;
+
+    glyph_cache_header want = glyph_cache_key(font_hash);
+    glyph_cache_header have;
+    memcpy(& have, cache.data, sizeof(have));
+    if (memcmp(have.magic, want.magic, sizeof(want.magic)) != 0
+        || have.version != want.version
+        || have.nglyphs != want.nglyphs
+        || have.font_hash != want.font_hash
+        || have.thickness != want.thickness
+        || have.nlods != want.nlods
+        || memcmp(have.lod_tolerance, want.lod_tolerance, sizeof(want.lod_tolerance)) != 0
+        || have.half_positions != want.half_positions) return false;
+
+    const char * payload = cache.data + sizeof(glyph_cache_header);
+    if (have.payload_size != cache.size - sizeof(glyph_cache_header)) return false;
+    uint32_t nentries = have.nglyphs * NLODS;
+    if (have.payload_size < nentries * sizeof(glyph_cache_entry)) return false;
+    if (fnv1a(payload, have.payload_size) != have.payload_hash) return false;
+
+    const glyph_cache_entry * entries = (const glyph_cache_entry *) payload;
+    const char * data = (const char *) (entries + nentries);
+    uint64_t data_size = have.payload_size - nentries * sizeof(glyph_cache_entry);
+    uint64_t vertex_bytes = 0;
+    uint64_t index_bytes = 0;
+    size_t soup_vertices[NLODS] = {};
+    size_t bytes[NLODS] = {};
+    for (uint32_t ix=0 ; ix<nentries ; ix+=1) {
+        const glyph_cache_entry & e = entries[ix];
+        uint64_t nvertex_bytes = e.nvertices * (uint64_t) vertex_stride();
+        uint64_t nindex_bytes = e.nindices * (uint64_t) (e.wide_indices ? 4 : 2);
+        if (e.vertex_offset + nvertex_bytes > data_size) return false;
+        if (e.index_offset + nindex_bytes > data_size) return false;
+        vertex_bytes += nvertex_bytes;
+        index_bytes += nindex_bytes;
+        soup_vertices[ix % NLODS] += e.nindices;
+        bytes[ix % NLODS] += nvertex_bytes + nindex_bytes;
+    }
+
+    // straight from the mapping into the arena
+    arena.reserve(vertex_bytes, index_bytes + 4 * nentries);
+    for (uint32_t c=0 ; c<have.nglyphs ; c+=1) {
+        Character & ch = preloaded_glyph(c);
+        ch.advance_x = entries[c * NLODS].advance_x;
+        ch.left = entries[c * NLODS].left;
+        ch.right = entries[c * NLODS].right;
+        ch.top = entries[c * NLODS].top;
+        ch.bot = entries[c * NLODS].bot;
+        for (int lod=0 ; lod<NLODS ; lod+=1) {
+            const glyph_cache_entry & e = entries[c * NLODS + lod];
+            ch.lods[lod] = arena.alloc(data + e.vertex_offset, e.nvertices,
+                                       data + e.index_offset, e.nindices, e.wide_indices);
+            if (bake_words) {
+                mesh_data & m = ch.source[lod];
+                size_t index_bytes = e.nindices * (e.wide_indices ? 4 : 2);
+                m.vertices.assign(data + e.vertex_offset, data + e.vertex_offset + e.nvertices * vertex_stride());
+                m.indices.assign(data + e.index_offset, data + e.index_offset + index_bytes);
+                m.nvertices = e.nvertices;
+                m.nindices = e.nindices;
+                m.wide_indices = e.wide_indices;
+            }
+        }
+        make_resident(ch);
+    }
+    report_glyph_bytes(have.nglyphs, soup_vertices, bytes);
+    return true;
+}
+
+void save_glyph_cache(string filename, uint64_t font_hash, vector<glyph_mesh> & meshes) {
+    vector<glyph_cache_entry> entries(meshes.size() * NLODS);
+    uint64_t offset = 0;
+    for (size_t ix=0 ; ix<entries.size() ; ix+=1) {
+        glyph_mesh & g = meshes[ix / NLODS];
+        mesh_data & m = g.lods[ix % NLODS];
+        entries[ix] = {g.advance_x, g.left, g.right, g.top, g.bot,
+                       (uint32_t) m.nvertices, (uint32_t) m.nindices, m.wide_indices,
+                       offset, offset + m.vertices.size()};
+        offset += m.bytes();
+    }
+
+    size_t entry_bytes = entries.size() * sizeof(glyph_cache_entry);
+    vector<char> payload(entry_bytes + offset);
+    memcpy(& payload[0], & entries[0], entry_bytes);
+    char * data = & payload[entry_bytes];
+    for (size_t ix=0 ; ix<entries.size() ; ix+=1) {
+        mesh_data & m = meshes[ix / NLODS].lods[ix % NLODS];
+        if (! m.vertices.empty()) memcpy(data + entries[ix].vertex_offset, m.vertices.data(), m.vertices.size());
+        if (! m.indices.empty()) memcpy(data + entries[ix].index_offset, m.indices.data(), m.indices.size());
+    }
+
+    glyph_cache_header h = glyph_cache_key(font_hash);
+    h.payload_size = payload.size();
+    h.payload_hash = fnv1a(& payload[0], payload.size());
+
+    // write to the side and rename so a crash never leaves a half-written cache
+    string tmpname = filename + ".tmp";
+    ofstream f(tmpname, ios::binary | ios::trunc);
+    f.write((const char *) & h, sizeof(h));
+    f.write(& payload[0], payload.size());
+    f.close();
+    if (! f) {
+        cerr << "could not write glyph cache " << tmpname << endl;
+        remove(tmpname.c_str());
+        return;
+    }
+    remove(filename.c_str());
+    if (rename(tmpname.c_str(), filename.c_str()) != 0) remove(tmpname.c_str());
+}
+
+// tessellate every glyph in meshes, spread over nthreads workers
+void tessellate_glyphs(vector<glyph_mesh> & meshes, int nthreads) {
+    atomic<int> next(0);
+    auto work = [&]() {
+        glyph_worker worker;
+        for (int ix=next++ ; ix<(int) meshes.size() ; ix=next++) {
+            tessellate_glyph(worker, preloaded_glyph_index(worker.face, ix), meshes[ix]);
+        }
+    };
+
+    vector<thread> threads;
+    for (int ix=1 ; ix<nthreads ; ix+=1) threads.emplace_back(work);
+    work();
+    for (auto & t : threads) t.join();
+}
+
+int glyph_threads = 0; // 0 means one per core
+bool glyph_timing = false;
+
+int glyph_thread_count() {
+    if (glyph_threads > 0) return glyph_threads;
+    return max(1u, thread::hardware_concurrency());
+}
+
+double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// wall time of the serial path against the worker pool at increasing core
+// counts, so we can see how tessellation scales
+void report_glyph_timing() {
+    int maxthreads = glyph_thread_count();
+    double serial = 0;
+    cout << "glyph tessellation, " << NPRELOAD << " glyphs" << endl;
+    for (int nthreads=1 ; ; nthreads=min(nthreads*2, maxthreads)) {
+        vector<glyph_mesh> meshes(NPRELOAD);
+        auto start = chrono::steady_clock::now();
+        tessellate_glyphs(meshes, nthreads);
+        double wall = seconds_since(start);
+        if (nthreads == 1) serial = wall;
+
+        cout << "  threads=" << nthreads
+             << " wall=" << wall * 1000 << "ms"
+             << " per_glyph=" << wall * 1e6 / NPRELOAD << "us"
+             << " speedup=" << serial / wall << "x" << endl;
+        if (nthreads == maxthreads) break;
+    }
+}
+
+void load_glyphs() {
+    mapped_file font_file;
+    if (! font_file.open(FONT_FILE)) die("font");
+    uint64_t font_hash = fnv1a(font_file.data, font_file.size);
+    font_file.close();
+
+    // the cache holds extruded meshes, outlines are cheap enough to redo
+    string cache_name = string(FONT_FILE) + ".glyphcache";
+    bool use_cache = ! glyph_timing && ! gpu_extrude;
+    if (use_cache && load_glyph_cache(cache_name, font_hash)) return;
+
+    if (glyph_timing) report_glyph_timing();
+
+    if (! gpu_extrude) cout << "rebuilding glyph cache " << cache_name << endl;
+
+    // cpu work on the pool, gl upload stays on the context thread
+    vector<glyph_mesh> meshes(NPRELOAD);
+    heap_window heap;
+    tessellate_glyphs(meshes, glyph_thread_count());
+    heap.report("tessellation");
+    if (glyph_arena) {
+        cout << "  arena: " << arena_allocations.load() << " allocations, peak "
+             << arena_peak.load() / 1024 << " KB per outline" << endl;
+    }
+
+    size_t soup_vertices[NLODS] = {};
+    size_t bytes[NLODS] = {};
+    for (int c=0 ; c<NPRELOAD ; c+=1) {
+        upload_glyph(preloaded_glyph(c), meshes[c]);
+        for (int lod=0 ; lod<NLODS ; lod+=1) {
+            if (gpu_extrude) {
+                const outline_data & o = meshes[c].outlines[lod];
+                soup_vertices[lod] += 2 * o.cap_indices.size() + 6 * (o.edges.size() / 4);
+                bytes[lod] += o.bytes();
+                continue;
+            }
+            soup_vertices[lod] += meshes[c].lods[lod].nindices;
+            bytes[lod] += meshes[c].lods[lod].bytes();
+        }
+    }
+    report_glyph_bytes(NPRELOAD, soup_vertices, bytes);
+
+    if (! gpu_extrude) save_glyph_cache(cache_name, font_hash, meshes);
+}
+
+// background tessellation of glyphs outside the preloaded set. requests and
+// results cross threads through the two queues, the gl upload and the
+// Characters table stay on the context thread
+struct glyph_loader {
+    thread worker;
+    mutex lock;
+    condition_variable wake;
+    deque<glyph_key> requests;
+    vector<pair<glyph_key, glyph_mesh>> done;
+    int pending = 0; // requested and not yet done
+    condition_variable idle;
+    bool stopping = false;
+
+    void request(glyph_key key);
+    void run();
+    void drain();
+    void stop();
+};
+
+void glyph_loader::request(glyph_key key) {
+    lock_guard<mutex> guard(lock);
+    if (! worker.joinable()) worker = thread(& glyph_loader::run, this);
+    requests.push_back(key);
+    pending += 1;
+    wake.notify_one();
+}
+
+// wait until every requested glyph is done, so recordings don't depend on
+// how fast the loader happens to be
+void glyph_loader::drain() {
+    unique_lock<mutex> guard(lock);
+    idle.wait(guard, [&]() { return pending == 0; });
+}
+
+void glyph_loader::run() {
+    name_thread("glyph loader");
+    glyph_worker w;
+    while (true) {
+        unique_lock<mutex> guard(lock);
+        wake.wait(guard, [&]() { return stopping || ! requests.empty(); });
+        if (stopping) return;
+        glyph_key key = requests.front();
+        requests.pop_front();
+        guard.unlock();
+
+        glyph_mesh mesh;
+        {
+            stage_timer timer("tessellate_glyph");
+            w.use_font(key >> 32);
+            tessellate_glyph(w, FT_Get_Char_Index(w.face, (char32_t) key), mesh);
+        }
+
+        guard.lock();
+        done.emplace_back(key, move(mesh));
+        pending -= 1;
+        if (pending == 0) idle.notify_all();
+    }
+}
+
+void glyph_loader::stop() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+        wake.notify_one();
+    }
+    if (worker.joinable()) worker.join();
+}
+
+glyph_loader loader;
+
+void stop_glyph_loader() {
+    loader.stop();
+}
+
+// the glyph if its meshes are on the gpu, otherwise the placeholder, queueing
+// it for tessellation the first time it is seen or after it was evicted.
+// this is the lookup for drawing, and keeps the glyph from being evicted
+const Character & glyph(int font, char32_t c) {
+    Character & ch = Characters[key_of(font, c)];
+    ch.last_drawn = glyph_clock;
+    if (ch.resident) {
+        glyph_stats.hits += 1;
+        return ch;
+    }
+    glyph_stats.misses += 1;
+    if (! ch.requested) {
+        ch.requested = true;
+        loader.request(key_of(font, c));
+    }
+    return placeholder;
+}
+
+// for layout, which only needs the metrics, and those survive eviction
+const Character & glyph_metrics(int font, char32_t c) {
+    auto it = Characters.find(key_of(font, c));
+    if (it != Characters.end() && it->second.ready) return it->second;
+    return glyph(font, c);
+}
+
+// moves on whenever new glyphs are uploaded, so words measured around the
+// placeholder know to measure again
+int glyph_generation = 0;
+
+// called once per frame on the context thread, before anything is drawn
+void upload_loaded_glyphs() {
+    glyph_clock += 1;
+    vector<pair<glyph_key, glyph_mesh>> done;
+    {
+        lock_guard<mutex> guard(loader.lock);
+        done.swap(loader.done);
+    }
+
+    for (auto & item : done) {
+        upload_glyph(Characters[item.first], item.second);
+    }
+    if (! done.empty()) glyph_generation += 1;
+    evict_glyphs();
+}
+
+// invalid sequences decode to U+FFFD
+vector<char32_t> decode_utf8(const string & text) {
+    vector<char32_t> codepoints;
+    size_t ix = 0;
+    while (ix < text.size()) {
+        unsigned char lead = text[ix];
+        int len = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xe ? 3 : (lead >> 3) == 0x1e ? 4 : 0;
+        char32_t c = len == 1 ? lead : len == 2 ? lead & 0x1f : len == 3 ? lead & 0x0f : lead & 0x07;
+
+        bool valid = len > 0 && ix + len <= text.size();
+        for (int n=1 ; valid && n<len ; n+=1) {
+            unsigned char cont = text[ix+n];
+            valid = (cont & 0xc0) == 0x80;
+            c = (c << 6) | (cont & 0x3f);
+        }
+
+        if (valid) {
+            codepoints.push_back(c);
+            ix += len;
+        } else {
+            codepoints.push_back(0xfffd);
+            ix += 1;
+        }
+    }
+    return codepoints;
+}
+
+string read_file(string filename) {
+    ifstream f(filename, ios::binary);
+    return string(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+}
+
+//TODO implement physically based materials
+GLuint compile_shader(GLenum type, const char * code, string what) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, & code, NULL);
+    glCompileShader(shader);
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, & success);
+    if (! success) {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        cout << infoLog << endl;
+        die(what);
+    }
+    return shader;
+}
+
+GLuint link_program(GLuint vertexShader, GLuint fragmentShader, bool retrievable=false) {
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    if (retrievable) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, & success);
+    if (! success) die("shader program");
+
+    // delete shaders (unneeded after program link)
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    return program;
+}
+
+// programs are built from name.vert and name.frag. the linked binary is kept
+// in name.progbin and used while the sources and the driver are unchanged,
+// which skips the compile entirely on slow (software) drivers
+const char PROGRAM_CACHE_MAGIC[8] = {'t', '3', 'd', 'p', 'r', 'o', 'g', '1'};
+
+struct program_cache_header {
+    char magic[8];
+    uint64_t source_hash;
+    uint64_t driver_hash;
+    uint32_t format;
+    uint32_t size;
+};
+
+bool program_cache = true;
+
+// a driver update can change the binary format without changing its id
+uint64_t driver_hash() {
+    uint64_t hash = fnv1a("", 0);
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION}) {
+        const char * value = (const char *) glGetString(name);
+        if (value) hash = fnv1a(value, strlen(value) + 1, hash);
+    }
+    return hash;
+}
+
+// cached says if the program came from name.progbin. a binary the driver
+// rejects is a miss, and gets rebuilt and rewritten
+GLuint load_program(string vertex_file, string fragment_file, string cache_name, bool & cached) {
+    string vertex_code = read_file(vertex_file);
+    string fragment_code = read_file(fragment_file);
+    if (vertex_code.empty() || fragment_code.empty()) die("can't read " + vertex_file + " or " + fragment_file);
+    uint64_t source_hash = fnv1a(vertex_code.c_str(), vertex_code.size() + 1);
+    source_hash = fnv1a(fragment_code.c_str(), fragment_code.size() + 1, source_hash);
+
+    GLint nformats = 0;
+    if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, & nformats);
+    bool binaries = program_cache && nformats > 0;
+
+    cached = false;
+    if (binaries) {
+        string cache = read_file(cache_name);
+        program_cache_header h;
+        if (cache.size() >= sizeof(h)) memcpy(& h, cache.data(), sizeof(h));
+        if (cache.size() >= sizeof(h)
+            && memcmp(h.magic, PROGRAM_CACHE_MAGIC, sizeof(h.magic)) == 0
+            && h.source_hash == source_hash
+            && h.driver_hash == driver_hash()
+            && h.size == cache.size() - sizeof(h)) {
+            GLuint program = glCreateProgram();
+            glProgramBinary(program, h.format, cache.data() + sizeof(h), h.size);
+            int success;
+            glGetProgramiv(program, GL_LINK_STATUS, & success);
+            if (success) {
+                cached = true;
+                return program;
+            }
+            glDeleteProgram(program);
+        }
+    }
+
+    GLuint program = link_program(compile_shader(GL_VERTEX_SHADER, vertex_code.c_str(), vertex_file),
+                                  compile_shader(GL_FRAGMENT_SHADER, fragment_code.c_str(), fragment_file),
+                                  binaries);
+    if (binaries) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, & length);
+        if (length > 0) {
+            program_cache_header h;
+            memcpy(h.magic, PROGRAM_CACHE_MAGIC, sizeof(h.magic));
+            h.source_hash = source_hash;
+            h.driver_hash = driver_hash();
+            string cache(sizeof(h) + length, '\0');
+            GLenum format;
+            glGetProgramBinary(program, length, & length, & format, & cache[sizeof(h)]);
+            h.format = format;
+            h.size = length;
+            memcpy(& cache[0], & h, sizeof(h));
+            cache.resize(sizeof(h) + length);
+            ofstream out(cache_name, ios::binary);
+            out.write(cache.data(), cache.size());
+        }
+    }
+    return program;
+}
+
+GLuint load_program(string name, bool & cached) {
+    return load_program(name + ".vert", name + ".frag", name + ".progbin", cached);
+}
+
+// uniform locations of the scene program, looked up once when it is loaded
+struct scene_uniforms {
+    GLint projection;
+    GLint view;
+    GLint light_pos;
+    GLint light_color;
+};
+
+scene_uniforms scene_locs;
+
+void setup_shaders() {
+    auto start = chrono::steady_clock::now();
+    bool cached;
+    shaderProgram = load_program("text3d", cached);
+    scene_locs.projection = glGetUniformLocation(shaderProgram, "projection");
+    scene_locs.view = glGetUniformLocation(shaderProgram, "view");
+    scene_locs.light_pos = glGetUniformLocation(shaderProgram, "lightPos");
+    scene_locs.light_color = glGetUniformLocation(shaderProgram, "lightColor");
+
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    cout << "shaders: " << elapsed.count() << "ms"
+         << (cached ? " (program cache)" : " (compiled)") << endl;
+}
+
+// multi-channel signed distance field atlas of the preloaded glyphs, for
+// words too small on screen to be worth their meshes. each channel holds the
+// distance to the nearest outline edge of its color, and edges change color
+// at corners, so the median of the three keeps corners sharp (chlumsky's
+// msdf) where a single channel would round them off
+const int SDF_EM = 32;    // atlas texels per em
+const int SDF_RANGE = 4;  // texels of distance field either side of the edge
+const int SDF_ATLAS_WIDTH = 1024;
+
+// words go to quads below SDF_ENTER pixels per em and back to meshes above
+// SDF_LEAVE, so a word hovering at the threshold doesn't flicker between them
+const float SDF_ENTER = 10;
+const float SDF_LEAVE = 14;
+
+bool sdf_text = true;
+
+struct sdf_glyph {
+    bool present = false; // false for blanks
+    glm::vec4 rect;       // glyph space left, bottom, right, top, padded by the range
+    glm::vec4 uv;
+    int width = 0;        // texels
+    int height = 0;
+    vector<uint8_t> rgb;  // rows bottom up, dropped once in the atlas
+};
+
+struct sdf_atlas {
+    GLuint texture = 0;
+    int width = SDF_ATLAS_WIDTH;
+    int height = 0;
+    sdf_glyph glyphs[NGLYPHS];
+
+    bool covers(const vector<char32_t> & word) const;
+};
+
+sdf_atlas sdf_font;
+
+bool sdf_atlas::covers(const vector<char32_t> & word) const {
+    if (! texture) return false;
+    for (char32_t c : word) if (c >= (char32_t) NGLYPHS) return false;
+    return true;
+}
+
+// edge colors are channel masks; any two of cyan, magenta and yellow share
+// exactly one channel
+const int SDF_RED = 1, SDF_GREEN = 2, SDF_BLUE = 4;
+const int SDF_CYAN = SDF_GREEN | SDF_BLUE;
+const int SDF_MAGENTA = SDF_RED | SDF_BLUE;
+const int SDF_YELLOW = SDF_RED | SDF_GREEN;
+const int SDF_WHITE = SDF_RED | SDF_GREEN | SDF_BLUE;
+
+// a glyph outline flattened finely, remembering which points were on the
+// outline itself, since only those can be corners
+struct sdf_outline {
+    vector<vector<glm::vec2>> contours;
+    vector<vector<bool>> knots;
+    float tolerance;
+    glm::vec2 last;
+
+    void point(glm::vec2 p, bool knot) {
+        contours.back().push_back(p);
+        knots.back().push_back(knot);
+        last = p;
+    }
+};
+
+int sdf_moveto(const FT_Vector * to, void * user) {
+    auto * o = (sdf_outline *) user;
+    o->contours.emplace_back();
+    o->knots.emplace_back();
+    o->point(glm::vec2(to->x, to->y), true);
+    return 0;
+}
+
+int sdf_lineto(const FT_Vector * to, void * user) {
+    ((sdf_outline *) user)->point(glm::vec2(to->x, to->y), true);
+    return 0;
+}
+
+int sdf_conicto(const FT_Vector * ctl, const FT_Vector * to, void * user) {
+    auto * o = (sdf_outline *) user;
+    glm::vec2 from = o->last, c(ctl->x, ctl->y), end(to->x, to->y);
+    int nsegments = bezier_segments(2 * glm::length(from - 2.0f*c + end), o->tolerance);
+    for (int ix=1 ; ix<nsegments ; ix+=1) {
+        float t = ix / float(nsegments);
+        float s = 1 - t;
+        o->point(s*s * from + 2*s*t * c + t*t * end, false);
+    }
+    o->point(end, true);
+    return 0;
+}
+
+int sdf_cubicto(const FT_Vector * ctl1, const FT_Vector * ctl2, const FT_Vector * to, void * user) {
+    auto * o = (sdf_outline *) user;
+    glm::vec2 from = o->last, c1(ctl1->x, ctl1->y), c2(ctl2->x, ctl2->y), end(to->x, to->y);
+    float bend = max(glm::length(from - 2.0f*c1 + c2), glm::length(c1 - 2.0f*c2 + end));
+    int nsegments = bezier_segments(6 * bend, o->tolerance);
+    for (int ix=1 ; ix<nsegments ; ix+=1) {
+        float t = ix / float(nsegments);
+        float s = 1 - t;
+        o->point(s*s*s * from + 3*s*s*t * c1 + 3*s*t*t * c2 + t*t*t * end, false);
+    }
+    o->point(end, true);
+    return 0;
+}
+
+FT_Outline_Funcs sdf_funcs = {& sdf_moveto, & sdf_lineto, & sdf_conicto, & sdf_cubicto, 0, 0};
+
+// open_start/open_end mark segments that end an edge at a corner. past those
+// ends the distance is measured to the segment's line, which is what lets
+// two channels meet in a sharp corner
+struct sdf_segment {
+    glm::vec2 a;
+    glm::vec2 b;
+    int color;
+    bool open_start;
+    bool open_end;
+};
+
+float cross2(glm::vec2 a, glm::vec2 b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+// split each contour into edges at its corners and color them, as in
+// msdfgen's simple edge coloring
+void color_contour(const vector<glm::vec2> & points, const vector<bool> & knots, vector<sdf_segment> & out) {
+    // closed contours repeat their first point at the end
+    vector<glm::vec2> p;
+    vector<bool> knot;
+    for (size_t ix=0 ; ix<points.size() ; ix+=1) {
+        if (! p.empty() && points[ix] == p.back()) continue;
+        p.push_back(points[ix]);
+        knot.push_back(knots[ix]);
+    }
+    while (p.size() > 1 && p.back() == p.front()) {
+        p.pop_back();
+        knot.pop_back();
+    }
+    int n = p.size();
+    if (n < 3) return;
+
+    // a corner turns more than about 8 degrees at an outline point
+    const float CORNER_SIN = sin(3.0f);
+    vector<int> corners;
+    for (int ix=0 ; ix<n ; ix+=1) {
+        if (! knot[ix]) continue;
+        glm::vec2 in = glm::normalize(p[ix] - p[(ix + n - 1) % n]);
+        glm::vec2 out = glm::normalize(p[(ix + 1) % n] - p[ix]);
+        if (glm::dot(in, out) <= 0 || fabs(cross2(in, out)) > CORNER_SIN) corners.push_back(ix);
+    }
+
+    vector<int> colors(n, SDF_WHITE);
+    vector<bool> edge_start(n, false);
+    int ncorners = corners.size();
+    if (ncorners == 1) {
+        // a teardrop: three colors round the one edge
+        const int thirds[3] = {SDF_MAGENTA, SDF_WHITE, SDF_YELLOW};
+        for (int k=0 ; k<n ; k+=1) colors[(corners[0] + k) % n] = thirds[min(2, 3*k / n)];
+        edge_start[corners[0]] = true;
+    } else if (ncorners > 1) {
+        const int palette[3] = {SDF_CYAN, SDF_MAGENTA, SDF_YELLOW};
+        int first = palette[0];
+        int color = first;
+        for (int e=0 ; e<ncorners ; e+=1) {
+            if (e > 0) {
+                int next = palette[e % 3];
+                if (e == ncorners-1 && next == first) {
+                    for (int c : palette) if (c != color && c != first) next = c;
+                }
+                color = next;
+            }
+            int end = corners[(e + 1) % ncorners];
+            int ix = corners[e];
+            do {
+                colors[ix] = color;
+                ix = (ix + 1) % n;
+            } while (ix != end);
+            edge_start[corners[e]] = true;
+        }
+    }
+
+    for (int ix=0 ; ix<n ; ix+=1) {
+        out.push_back({p[ix], p[(ix + 1) % n], colors[ix], edge_start[ix], edge_start[(ix + 1) % n]});
+    }
+}
+
+// the glyph loaded in w.face as an msdf bitmap
+void render_sdf_glyph(glyph_worker & w, sdf_glyph & g) {
+    float font_size = w.face->units_per_EM;
+    sdf_outline outline;
+    outline.tolerance = 0.001 * font_size;
+    FT_Outline_Decompose(& w.face->glyph->outline, & sdf_funcs, & outline);
+
+    vector<sdf_segment> segments;
+    glm::vec2 lo(INFINITY), hi(-INFINITY);
+    float area = 0;
+    for (size_t c=0 ; c<outline.contours.size() ; c+=1) {
+        for (glm::vec2 & p : outline.contours[c]) {
+            p /= font_size;
+            lo = glm::min(lo, p);
+            hi = glm::max(hi, p);
+        }
+        color_contour(outline.contours[c], outline.knots[c], segments);
+    }
+    for (auto & s : segments) area += cross2(s.a, s.b) / 2;
+    if (segments.empty() || area == 0) return;
+
+    // inside is to the left of counterclockwise contours
+    float inside = area > 0 ? 1 : -1;
+    float pad = SDF_RANGE / float(SDF_EM);
+    g.width = ceil((hi.x - lo.x) * SDF_EM) + 2 * SDF_RANGE;
+    g.height = ceil((hi.y - lo.y) * SDF_EM) + 2 * SDF_RANGE;
+    g.rect = glm::vec4(lo.x - pad, lo.y - pad, lo.x - pad + g.width / float(SDF_EM), lo.y - pad + g.height / float(SDF_EM));
+    g.rgb.resize(g.width * g.height * 3);
+    g.present = true;
+
+    for (int y=0 ; y<g.height ; y+=1) {
+        for (int x=0 ; x<g.width ; x+=1) {
+            glm::vec2 p(g.rect.x + (x + 0.5f) / SDF_EM, g.rect.y + (y + 0.5f) / SDF_EM);
+
+            // nearest segment per channel, ties (a shared endpoint) going to
+            // the segment the point is more square to
+            float best[3] = {INFINITY, INFINITY, INFINITY};
+            float best_square[3] = {0, 0, 0};
+            int nearest[3] = {-1, -1, -1};
+            int winding = 0;
+            for (int ix=0 ; ix<(int) segments.size() ; ix+=1) {
+                const sdf_segment & s = segments[ix];
+                glm::vec2 ab = s.b - s.a;
+                float t = glm::clamp(glm::dot(p - s.a, ab) / glm::dot(ab, ab), 0.0f, 1.0f);
+                glm::vec2 off = p - (s.a + t * ab);
+                float d = glm::length(off);
+                float square = d > 0 ? fabs(cross2(glm::normalize(ab), off / d)) : 1;
+                for (int c=0 ; c<3 ; c+=1) {
+                    if (! (s.color & (1 << c))) continue;
+                    if (d < best[c] - 1e-6f || (d <= best[c] + 1e-6f && square > best_square[c])) {
+                        best[c] = d;
+                        best_square[c] = square;
+                        nearest[c] = ix;
+                    }
+                }
+
+                // nonzero winding, for the sign check below
+                if ((s.a.y <= p.y) != (s.b.y <= p.y)) {
+                    float cross = cross2(ab, p - s.a);
+                    if (s.b.y > s.a.y && cross > 0) winding += 1;
+                    if (s.b.y <= s.a.y && cross < 0) winding -= 1;
+                }
+            }
+
+            float value[3];
+            for (int c=0 ; c<3 ; c+=1) {
+                const sdf_segment & s = segments[nearest[c]];
+                glm::vec2 ab = s.b - s.a;
+                float t = glm::dot(p - s.a, ab) / glm::dot(ab, ab);
+                float side = cross2(glm::normalize(ab), p - s.a);
+                float d = (t < 0 && s.open_start) || (t > 1 && s.open_end) ? fabs(side) : best[c];
+                float signed_d = (side * inside >= 0 ? d : -d);
+                value[c] = glm::clamp(0.5f + signed_d / (2 * pad), 0.0f, 1.0f);
+            }
+
+            // a texel whose median lands on the wrong side is flipped whole
+            float median = max(min(value[0], value[1]), min(max(value[0], value[1]), value[2]));
+            if ((median > 0.5f) != (winding != 0)) for (float & v : value) v = 1 - v;
+
+            uint8_t * out = & g.rgb[(y * g.width + x) * 3];
+            for (int c=0 ; c<3 ; c+=1) out[c] = lround(value[c] * 255);
+        }
+    }
+}
+
+// fields on the glyph thread pool, then shelf packed into one texture
+void build_sdf_atlas() {
+    auto start = chrono::steady_clock::now();
+    atomic<int> next(0);
+    auto work = [&]() {
+        glyph_worker w;
+        for (int c=next++ ; c<NGLYPHS ; c=next++) {
+            if (FT_Load_Glyph(w.face, FT_Get_Char_Index(w.face, c), FT_LOAD_NO_SCALE)) die("glyph");
+            render_sdf_glyph(w, sdf_font.glyphs[c]);
+        }
+    };
+    vector<thread> threads;
+    for (int ix=1 ; ix<glyph_thread_count() ; ix+=1) threads.emplace_back(work);
+    work();
+    for (auto & t : threads) t.join();
+
+    // a texel of space round every glyph so filtering never bleeds
+    int x = 1, y = 1, row = 0;
+    vector<glm::ivec2> at(NGLYPHS);
+    for (int c=0 ; c<NGLYPHS ; c+=1) {
+        sdf_glyph & g = sdf_font.glyphs[c];
+        if (! g.present) continue;
+        if (x + g.width + 1 > sdf_font.width) {
+            x = 1;
+            y += row + 1;
+            row = 0;
+        }
+        at[c] = glm::ivec2(x, y);
+        x += g.width + 1;
+        row = max(row, g.height);
+    }
+    sdf_font.height = y + row + 1;
+
+    vector<uint8_t> image(sdf_font.width * sdf_font.height * 3, 0);
+    for (int c=0 ; c<NGLYPHS ; c+=1) {
+        sdf_glyph & g = sdf_font.glyphs[c];
+        if (! g.present) continue;
+        for (int row=0 ; row<g.height ; row+=1) {
+            memcpy(& image[((at[c].y + row) * sdf_font.width + at[c].x) * 3], & g.rgb[row * g.width * 3], g.width * 3);
+        }
+        g.uv = glm::vec4(at[c].x / float(sdf_font.width), at[c].y / float(sdf_font.height),
+                         (at[c].x + g.width) / float(sdf_font.width), (at[c].y + g.height) / float(sdf_font.height));
+        g.rgb = vector<uint8_t>();
+    }
+
+    glGenTextures(1, & sdf_font.texture);
+    glBindTexture(GL_TEXTURE_2D, sdf_font.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, sdf_font.width, sdf_font.height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    cout << "sdf atlas: " << sdf_font.width << "x" << sdf_font.height << " in " << elapsed.count() << "ms" << endl;
+}
+
+// per-letter quad instances, like instance_data plus where the quad goes and
+// what part of the atlas it shows
+struct sdf_instance {
+    glm::mat4 model;
+    glm::mat3 normal_matrix;
+    glm::vec4 rect;
+    glm::vec4 uv;
+    glm::vec3 color;
+};
+
+struct sdf_draw_list {
+    GLuint program = 0;
+    GLuint VAO = 0;
+    GLint projection_loc;
+    GLint view_loc;
+    GLint light_pos_loc;
+    GLint light_color_loc;
+    vector<sdf_instance> instances;
+
+    void init();
+    void add(const glm::mat4 & model, const glm::mat3 & normal, const sdf_glyph & g, glm::vec3 color);
+    void submit(const glm::mat4 & projection, const glm::mat4 & view);
+};
+
+void sdf_draw_list::init() {
+    bool cached;
+    program = load_program("sdf_text", cached);
+    projection_loc = glGetUniformLocation(program, "projection");
+    view_loc = glGetUniformLocation(program, "view");
+    light_pos_loc = glGetUniformLocation(program, "lightPos");
+    light_color_loc = glGetUniformLocation(program, "lightColor");
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "atlas"), 0);
+    glUniform1f(glGetUniformLocation(program, "pxRange"), 2 * SDF_RANGE);
+
+    // every attribute is per instance, the corners come from gl_VertexID.
+    // they point into the upload ring, set at each submit
+    glGenVertexArrays(1, & VAO);
+    glBindVertexArray(VAO);
+    for (int ix=0 ; ix<=9 ; ix+=1) {
+        glEnableVertexAttribArray(ix);
+        glVertexAttribDivisor(ix, 1);
+    }
+    glBindVertexArray(0);
+}
+
+void sdf_draw_list::add(const glm::mat4 & model, const glm::mat3 & normal, const sdf_glyph & g, glm::vec3 color) {
+    instances.push_back({model, normal, g.rect, g.uv, color});
+}
+
+// after the meshes, blended over them; edges are the only part that isn't
+// opaque so draw order hardly shows
+void sdf_draw_list::submit(const glm::mat4 & projection, const glm::mat4 & view) {
+    if (instances.empty()) return;
+
+    glUseProgram(program);
+    glUniformMatrix4fv(projection_loc, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniformMatrix4fv(view_loc, 1, GL_FALSE, glm::value_ptr(view));
+    glUniform3f(light_pos_loc, 1.0, 1.0, -1.0);
+    glUniform3f(light_color_loc, 1.0, 1.0, 1.0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, sdf_font.texture);
+
+    size_t base = uploads.write(instances.data(), instances.size() * sizeof(sdf_instance));
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, uploads.buffer);
+    for (int col=0 ; col<4 ; col+=1) {
+        glVertexAttribPointer(col, 4, GL_FLOAT, GL_FALSE, sizeof(sdf_instance),
+                              (void *) (base + offsetof(sdf_instance, model) + col*sizeof(glm::vec4)));
+    }
+    for (int col=0 ; col<3 ; col+=1) {
+        glVertexAttribPointer(4 + col, 3, GL_FLOAT, GL_FALSE, sizeof(sdf_instance),
+                              (void *) (base + offsetof(sdf_instance, normal_matrix) + col*sizeof(glm::vec3)));
+    }
+    glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(sdf_instance), (void *) (base + offsetof(sdf_instance, rect)));
+    glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, sizeof(sdf_instance), (void *) (base + offsetof(sdf_instance, uv)));
+    glVertexAttribPointer(9, 3, GL_FLOAT, GL_FALSE, sizeof(sdf_instance), (void *) (base + offsetof(sdf_instance, color)));
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, instances.size());
+    glDisable(GL_BLEND);
+
+    instances.clear();
+}
+
+sdf_draw_list sdf_draws;
+
+// GL_TIME_ELAPSED queries, read back GPU_QUERY_LATENCY frames later without
+// waiting. a query still not done by the time its slot comes round again
+// just leaves that frame untimed
+const int GPU_QUERY_LATENCY = 4;
+
+struct gpu_timer {
+    GLuint queries[GPU_QUERY_LATENCY];
+    const char * names[GPU_QUERY_LATENCY];
+    double issued[GPU_QUERY_LATENCY];
+    bool pending[GPU_QUERY_LATENCY] = {};
+    int next = 0;
+    bool timing = false;
+
+    void init();
+    void collect();
+    void begin(const char * name);
+    void end();
+};
+
+void gpu_timer::init() {
+    glGenQueries(GPU_QUERY_LATENCY, queries);
+}
+
+void gpu_timer::collect() {
+    for (int ix=0 ; ix<GPU_QUERY_LATENCY ; ix+=1) {
+        if (! pending[ix]) continue;
+        GLint available = 0;
+        glGetQueryObjectiv(queries[ix], GL_QUERY_RESULT_AVAILABLE, & available);
+        if (! available) continue;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(queries[ix], GL_QUERY_RESULT, & elapsed);
+        profile.record({names[ix], GPU_TRACK, issued[ix], elapsed / 1e9});
+        pending[ix] = false;
+    }
+}
+
+// the gpu side of the events is placed at the cpu time it was submitted
+void gpu_timer::begin(const char * name) {
+    timing = ! pending[next];
+    if (! timing) return;
+    names[next] = name;
+    issued[next] = profile_now();
+    glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+}
+
+void gpu_timer::end() {
+    if (timing) {
+        glEndQuery(GL_TIME_ELAPSED);
+        pending[next] = true;
+    }
+    next = (next + 1) % GPU_QUERY_LATENCY;
+}
+
+gpu_timer gpu_frame;
+
+// --frame-graph: the last GRAPH_FRAMES frame times as bars in the bottom
+// left corner, with lines at 60 and 30 fps
+const int GRAPH_FRAMES = 240;
+const float GRAPH_FULL_SCALE = 1.0 / 20; // seconds at the top of the graph
+
+bool show_frame_graph = false;
+
+struct frame_graph {
+    GLuint program;
+    GLuint VAO;
+    GLint color_loc;
+    float times[GRAPH_FRAMES] = {};
+    int next = 0;
+    vector<float> lines;
+
+    void init();
+    void add(double seconds);
+    void draw();
+};
+
+void frame_graph::init() {
+    bool cached;
+    program = load_program("frame_graph", cached);
+    color_loc = glGetUniformLocation(program, "color");
+
+    glGenVertexArrays(1, & VAO);
+    glBindVertexArray(VAO);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+}
+
+void frame_graph::add(double seconds) {
+    times[next] = seconds;
+    next = (next + 1) % GRAPH_FRAMES;
+}
+
+void frame_graph::draw() {
+    const float left = -0.98, bottom = -0.98, width = 0.6, height = 0.4;
+    auto y = [&](float seconds) { return bottom + height * min(1.0f, seconds / GRAPH_FULL_SCALE); };
+
+    lines.clear();
+    for (int ix=0 ; ix<GRAPH_FRAMES ; ix+=1) {
+        float x = left + width * ix / GRAPH_FRAMES;
+        lines.insert(lines.end(), {x, bottom, x, y(times[(next + ix) % GRAPH_FRAMES])});
+    }
+    for (float seconds : {1 / 60.0f, 1 / 30.0f}) {
+        lines.insert(lines.end(), {left, y(seconds), left + width, y(seconds)});
+    }
+
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(program);
+    size_t base = uploads.write(lines.data(), lines.size() * sizeof(float));
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, uploads.buffer);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void *) base);
+
+    glUniform3f(color_loc, 0.2, 1.0, 0.2);
+    glDrawArrays(GL_LINES, 0, 2 * GRAPH_FRAMES);
+    glUniform3f(color_loc, 1.0, 0.3, 0.3);
+    glDrawArrays(GL_LINES, 2 * GRAPH_FRAMES, 4);
+
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+frame_graph graph;
+
+rp3d::DynamicsWorld * world;
+
+// a mutex that lets threads already waiting for it in ahead of the physics
+// thread, which releases it after every substep and would otherwise win it
+// straight back (std::mutex makes no promise of fairness)
+struct world_mutex {
+    mutex inner;
+    atomic<int> waiting{0};
+
+    void lock() {
+        waiting += 1;
+        inner.lock();
+        waiting -= 1;
+    }
+    void unlock() { inner.unlock(); }
+    void let_waiters_in() {
+        while (waiting.load() > 0) this_thread::yield();
+    }
+};
+
+// the world, its bodies and the springs belong to the physics thread once it
+// is running, anything else touching them takes world_lock
+world_mutex world_lock;
+
+// bodies whose transforms are published to the renderer, by pose index.
+// indexes of destroyed bodies are null until reused. the generation of a
+// pose changes whenever it jumps, so the renderer doesn't blend across it
+vector<rp3d::RigidBody *> tracked_bodies;
+vector<uint32_t> tracked_generations;
+vector<int> free_poses;
+
+int track_body(rp3d::RigidBody * body) {
+    lock_guard<world_mutex> guard(world_lock);
+    if (! free_poses.empty()) {
+        int pose_index = free_poses.back();
+        free_poses.pop_back();
+        tracked_bodies[pose_index] = body;
+        tracked_generations[pose_index] += 1;
+        return pose_index;
+    }
+    tracked_bodies.push_back(body);
+    tracked_generations.push_back(0);
+    return tracked_bodies.size() - 1;
+}
+
+// called with world_lock held, after moving a body somewhere new
+void teleport_body(int pose_index) {
+    tracked_generations[pose_index] += 1;
+}
+
+// called with world_lock held, before the body is destroyed, so the physics
+// thread never publishes from a freed body
+void untrack_body_locked(int pose_index) {
+    tracked_bodies[pose_index] = nullptr;
+    free_poses.push_back(pose_index);
+}
+
+struct spring {
+    rp3d::RigidBody * from_body;
+    rp3d::Vector3 from_con;
+    rp3d::RigidBody * to_body;
+    rp3d::Vector3 to_con;
+    float strength;
+    float rest_length;
+};
+
+// springs are stored as parallel arrays and solved together. each substep
+// gathers the transform of every body once, evaluates all the springs in
+// straight loops over floats, then scatters one force and one torque per body
+struct spring_system {
+    // per spring. a body slot of -1 is a fixed anchor, its connection point
+    // is then in world coordinates
+    vector<int> from_slot;
+    vector<int> to_slot;
+    vector<float> from_con[3];
+    vector<float> to_con[3];
+    vector<float> strength;
+    vector<float> rest_length;
+
+    // per body
+    vector<rp3d::RigidBody *> bodies;
+    unordered_map<rp3d::RigidBody *, int> body_slots;
+
+    // scratch, reused between substeps
+    vector<float> origin[3];
+    vector<float> rotation[9];
+    vector<float> from_p[3];
+    vector<float> to_p[3];
+    vector<float> force[3];
+    vector<float> body_force[3];
+    vector<float> body_torque[3];
+
+    int size() const { return strength.size(); }
+    int slot(rp3d::RigidBody * body);
+    void add(const spring & s);
+    void remove(rp3d::RigidBody * body);
+    void gather();
+    void endpoints(const vector<int> & slots, const vector<float> * con, vector<float> * out);
+    void apply_forces();
+};
+
+int spring_system::slot(rp3d::RigidBody * body) {
+    if (! body) return -1;
+    auto it = body_slots.emplace(body, bodies.size());
+    if (it.second) bodies.push_back(body);
+    return it.first->second;
+}
+
+void spring_system::add(const spring & s) {
+    from_slot.push_back(slot(s.from_body));
+    to_slot.push_back(slot(s.to_body));
+    for (int c=0 ; c<3 ; c+=1) {
+        from_con[c].push_back(s.from_con[c]);
+        to_con[c].push_back(s.to_con[c]);
+    }
+    strength.push_back(s.strength);
+    rest_length.push_back(s.rest_length);
+}
+
+// drops the body and every spring attached to it
+void spring_system::remove(rp3d::RigidBody * body) {
+    auto found = body_slots.find(body);
+    if (found == body_slots.end()) return;
+    int gone = found->second;
+
+    vector<bool> keep(size());
+    for (int s=0 ; s<size() ; s+=1) keep[s] = from_slot[s] != gone && to_slot[s] != gone;
+    auto compact = [&](auto & values) {
+        int kept = 0;
+        for (int s=0 ; s<(int) values.size() ; s+=1) {
+            if (keep[s]) values[kept++] = values[s];
+        }
+        values.resize(kept);
+    };
+    compact(from_slot);
+    compact(to_slot);
+    for (int c=0 ; c<3 ; c+=1) {
+        compact(from_con[c]);
+        compact(to_con[c]);
+    }
+    compact(strength);
+    compact(rest_length);
+
+    // the last body moves into the freed slot
+    int last = bodies.size() - 1;
+    if (gone != last) {
+        bodies[gone] = bodies[last];
+        body_slots[bodies[gone]] = gone;
+        for (int & b : from_slot) if (b == last) b = gone;
+        for (int & b : to_slot) if (b == last) b = gone;
+    }
+    bodies.pop_back();
+    body_slots.erase(body);
+}
+
+// body positions and rotation matrices, from the quaternion directly
+void spring_system::gather() {
+    int nbodies = bodies.size();
+    for (int c=0 ; c<3 ; c+=1) origin[c].resize(nbodies);
+    for (int c=0 ; c<9 ; c+=1) rotation[c].resize(nbodies);
+
+    for (int b=0 ; b<nbodies ; b+=1) {
+        const rp3d::Transform & t = bodies[b]->getTransform();
+        const rp3d::Vector3 & p = t.getPosition();
+        const rp3d::Quaternion & q = t.getOrientation();
+        origin[0][b] = p.x;
+        origin[1][b] = p.y;
+        origin[2][b] = p.z;
+
+        float xx = q.x*q.x, yy = q.y*q.y, zz = q.z*q.z;
+        float xy = q.x*q.y, xz = q.x*q.z, yz = q.y*q.z;
+        float wx = q.w*q.x, wy = q.w*q.y, wz = q.w*q.z;
+        rotation[0][b] = 1 - 2*(yy + zz);
+        rotation[1][b] = 2*(xy - wz);
+        rotation[2][b] = 2*(xz + wy);
+        rotation[3][b] = 2*(xy + wz);
+        rotation[4][b] = 1 - 2*(xx + zz);
+        rotation[5][b] = 2*(yz - wx);
+        rotation[6][b] = 2*(xz - wy);
+        rotation[7][b] = 2*(yz + wx);
+        rotation[8][b] = 1 - 2*(xx + yy);
+    }
+}
+
+// world position of one end of every spring
+void spring_system::endpoints(const vector<int> & slots, const vector<float> * con, vector<float> * out) {
+    int n = size();
+    for (int c=0 ; c<3 ; c+=1) out[c].resize(n);
+    for (int s=0 ; s<n ; s+=1) {
+        int b = slots[s];
+        float x = con[0][s], y = con[1][s], z = con[2][s];
+        if (b < 0) {
+            out[0][s] = x;
+            out[1][s] = y;
+            out[2][s] = z;
+            continue;
+        }
+        out[0][s] = rotation[0][b]*x + rotation[1][b]*y + rotation[2][b]*z + origin[0][b];
+        out[1][s] = rotation[3][b]*x + rotation[4][b]*y + rotation[5][b]*z + origin[1][b];
+        out[2][s] = rotation[6][b]*x + rotation[7][b]*y + rotation[8][b]*z + origin[2][b];
+    }
+}
+
+void spring_system::apply_forces() {
+    int n = size();
+    if (n == 0) return;
+
+    gather();
+    endpoints(from_slot, from_con, from_p);
+    endpoints(to_slot, to_con, to_p);
+
+    // hooke's law, with one inverse square root giving both length and unit
+    for (int c=0 ; c<3 ; c+=1) force[c].resize(n);
+    float * fx = force[0].data();
+    float * fy = force[1].data();
+    float * fz = force[2].data();
+    for (int s=0 ; s<n ; s+=1) {
+        float dx = from_p[0][s] - to_p[0][s];
+        float dy = from_p[1][s] - to_p[1][s];
+        float dz = from_p[2][s] - to_p[2][s];
+        float length_sq = dx*dx + dy*dy + dz*dz;
+        float inv_length = length_sq > 0 ? 1 / sqrtf(length_sq) : 0;
+        float k = strength[s] * (length_sq * inv_length - rest_length[s]) * inv_length;
+        fx[s] = k * dx;
+        fy[s] = k * dy;
+        fz[s] = k * dz;
+    }
+
+    // accumulate per body, torque about the body origin
+    int nbodies = bodies.size();
+    for (int c=0 ; c<3 ; c+=1) {
+        body_force[c].assign(nbodies, 0.0f);
+        body_torque[c].assign(nbodies, 0.0f);
+    }
+    auto scatter = [&](int b, int s, float sign, const vector<float> * p) {
+        float f[3] = {sign * fx[s], sign * fy[s], sign * fz[s]};
+        float r[3] = {p[0][s] - origin[0][b], p[1][s] - origin[1][b], p[2][s] - origin[2][b]};
+        body_force[0][b] += f[0];
+        body_force[1][b] += f[1];
+        body_force[2][b] += f[2];
+        body_torque[0][b] += r[1]*f[2] - r[2]*f[1];
+        body_torque[1][b] += r[2]*f[0] - r[0]*f[2];
+        body_torque[2][b] += r[0]*f[1] - r[1]*f[0];
+    };
+    for (int s=0 ; s<n ; s+=1) {
+        if (from_slot[s] >= 0) scatter(from_slot[s], s, -1, from_p);
+        if (to_slot[s] >= 0) scatter(to_slot[s], s, 1, to_p);
+    }
+
+    // a force through the origin plus the torque about it, which rp3d turns
+    // into the same thing about the center of mass
+    for (int b=0 ; b<nbodies ; b+=1) {
+        rp3d::Vector3 f(body_force[0][b], body_force[1][b], body_force[2][b]);
+        rp3d::Vector3 torque(body_torque[0][b], body_torque[1][b], body_torque[2][b]);
+        bodies[b]->applyForce(f, rp3d::Vector3(origin[0][b], origin[1][b], origin[2][b]));
+        bodies[b]->applyTorque(torque);
+    }
+}
+
+// the context thread's own faces, for layout and colliders
+FT_Library layout_library() {
+    static FT_Library ft = nullptr;
+    if (! ft && FT_Init_FreeType(& ft)) die("freetype");
+    return ft;
+}
+
+FT_Face layout_faces[MAX_FONTS] = {};
+
+FT_Face layout_face(int font) {
+    if (! layout_faces[font] && FT_New_Face(layout_library(), font_files[font].c_str(), 0, & layout_faces[font])) {
+        die("font " + font_files[font]);
+    }
+    return layout_faces[font];
+}
+
+// id of the font in file, opened the first time it is named. -1 if it
+// won't open or there are already MAX_FONTS
+int font_id(const string & file) {
+    for (int ix=0 ; ix<nfonts ; ix+=1) if (font_files[ix] == file) return ix;
+    if (nfonts == MAX_FONTS) return -1;
+
+    FT_Face face;
+    if (FT_New_Face(layout_library(), file.c_str(), 0, & face)) return -1;
+    layout_faces[nfonts] = face;
+    font_files[nfonts] = file;
+    nfonts += 1;
+    return nfonts - 1;
+}
+
+// kerning from each font's kern table. pairs are looked up once and remembered
+struct kerning_table {
+    unordered_map<uint64_t, float> pairs[MAX_FONTS];
+
+    float get(int font, char32_t left, char32_t right);
+};
+
+float kerning_table::get(int font, char32_t left, char32_t right) {
+    FT_Face face = layout_face(font);
+    if (! FT_HAS_KERNING(face)) return 0;
+
+    uint64_t key = (uint64_t) left << 32 | right;
+    auto it = pairs[font].find(key);
+    if (it != pairs[font].end()) return it->second;
+
+    FT_Vector kern = {0, 0};
+    FT_Get_Kerning(face, FT_Get_Char_Index(face, left), FT_Get_Char_Index(face, right),
+                   FT_KERNING_UNSCALED, & kern);
+    return pairs[font][key] = kern.x / float(face->units_per_EM);
+}
+
+kerning_table kerning;
+
+// where the letters of a word go, worked out once per text. x is centered on
+// the ink, y is the baseline
+struct word_layout {
+    int font = 0;
+    vector<float> pen; // x of each codepoint's origin
+    float left = 0;    // ink box
+    float right = 0;
+    float top = 0;
+    float bot = 0;
+    bool provisional = false; // some glyph was still the placeholder
+    int generation = 0;       // glyph_generation it was laid out at
+};
+
+word_layout layout_word(const vector<char32_t> & word, int font) {
+    word_layout out;
+    out.font = font;
+    out.generation = glyph_generation;
+    out.pen.resize(word.size());
+
+    float x = 0;
+    char32_t prev = 0;
+    float left = INFINITY, right = -INFINITY, top = -INFINITY, bot = INFINITY;
+    for (int ix=0 ; ix<(int) word.size() ; ix+=1) {
+        char32_t c = word[ix];
+        if (c == '\0') continue;
+
+        const Character & ch = glyph_metrics(font, c);
+        if (& ch == & placeholder) out.provisional = true;
+        if (prev) x += kerning.get(font, prev, c);
+        out.pen[ix] = x;
+
+        // blanks have no ink
+        if (ch.right > ch.left) {
+            left = min(left, x + ch.left);
+            right = max(right, x + ch.right);
+            top = max(top, ch.top);
+            bot = min(bot, ch.bot);
+        }
+        x += ch.advance_x;
+        prev = c;
+    }
+    if (left > right) {
+        left = 0;
+        right = x;
+        top = bot = 0;
+    }
+
+    float center = (left + right) / 2;
+    for (float & pen : out.pen) pen -= center;
+    out.left = left - center;
+    out.right = right - center;
+    out.top = top;
+    out.bot = bot;
+    return out;
+}
+
+// camera of the frame being drawn
+struct camera_state {
+    glm::mat4 projection;
+    glm::mat4 view;
+};
+
+camera_state camera;
+
+// projected size of text drawn with this model matrix, 0 behind the camera
+float pixels_per_em(const glm::mat4 & model) {
+    glm::vec4 clip = camera.projection * camera.view * model * glm::vec4(0, 0, 0, 1);
+    if (clip.w <= 0) return 0;
+    return camera.projection[1][1] / clip.w * SCREEN_HEIGHT / 2;
+}
+
+// coarsest lod whose flattening error stays under MAX_PIXEL_ERROR at this size
+int pick_lod(float pixels) {
+    for (int lod=0 ; lod<NLODS-1 ; lod+=1) {
+        if (LOD_TOLERANCE[lod] * pixels <= MAX_PIXEL_ERROR) return lod;
+    }
+    return NLODS - 1;
+}
+
+// depth only matters to --gpu-extrude, meshes are scaled to it by the model
+void draw_letter(const Character & ch, int lod, const glm::mat4 & model, const glm::mat3 & normal, glm::vec3 color, float depth) {
+    if (gpu_extrude) extrude_draws.add(ch.outlines[lod], model, normal, color, depth);
+    else frame_draws.add(ch.lods[lod], model, normal, color);
+}
+
+void draw_word(const vector<char32_t> & word, const word_layout & layout, const glm::mat4 & base_model, glm::vec3 color, int lod, float depth) {
+    // letters only translate within the word, so they share a normal matrix
+    glm::mat3 normal = normal_matrix(base_model);
+    for (int ix=0 ; ix<(int) word.size() ; ix+=1) {
+        if (word[ix] == '\0') continue;
+
+        auto model = glm::translate(base_model, glm::vec3(layout.pen[ix], 0.0f, 0.0f));
+        draw_letter(glyph(layout.font, word[ix]), lod, model, normal, color, depth);
+    }
+}
+
+// the same letters as atlas quads, only for words sdf_font covers
+void draw_word_sdf(const vector<char32_t> & word, const word_layout & layout, const glm::mat4 & base_model, glm::vec3 color) {
+    glm::mat3 normal = normal_matrix(base_model);
+    for (int ix=0 ; ix<(int) word.size() ; ix+=1) {
+        if (word[ix] == '\0') continue;
+        const sdf_glyph & g = sdf_font.glyphs[word[ix]];
+        if (! g.present) continue;
+
+        auto model = glm::translate(base_model, glm::vec3(layout.pen[ix], 0.0f, 0.0f));
+        sdf_draws.add(model, normal, g, color);
+    }
+}
+
+// move a packed vertex along x
+void shift_vertex(char * vertex, float dx) {
+    if (half_positions) {
+        uint32_t * words = (uint32_t *) vertex;
+        float x = glm::unpackHalf1x16(words[0] & 0xffff) + dx;
+        words[0] = (words[0] & 0xffff0000) | glm::packHalf1x16(x);
+    } else {
+        float x;
+        memcpy(& x, vertex, sizeof(x));
+        x += dx;
+        memcpy(vertex, & x, sizeof(x));
+    }
+}
+
+// the letters of a laid out word merged into one mesh per lod, so the whole
+// word is one draw. false if some letter has no cpu copy to build from
+bool bake_word(const vector<char32_t> & word, const word_layout & layout, mesh_ref baked[NLODS]) {
+    int stride = vertex_stride();
+    for (int lod=0 ; lod<NLODS ; lod+=1) {
+        int nvertices = 0;
+        int nindices = 0;
+        for (char32_t c : word) {
+            if (c == '\0') continue;
+            const Character & ch = glyph_metrics(layout.font, c);
+            const mesh_data & m = ch.source[lod];
+            if (m.nvertices == 0 && ch.lods[lod].count > 0) {
+                for (int done=0 ; done<lod ; done+=1) arena.release(baked[done]);
+                return false;
+            }
+            nvertices += m.nvertices;
+            nindices += m.nindices;
+        }
+
+        mesh_data merged;
+        merged.nvertices = nvertices;
+        merged.nindices = nindices;
+        merged.wide_indices = nvertices > 0xffff;
+        merged.vertices.resize(nvertices * stride);
+        merged.indices.resize(nindices * (merged.wide_indices ? 4 : 2));
+
+        int vertex = 0;
+        int index = 0;
+        for (int ix=0 ; ix<(int) word.size() ; ix+=1) {
+            if (word[ix] == '\0') continue;
+            const mesh_data & m = glyph_metrics(layout.font, word[ix]).source[lod];
+            char * out = & merged.vertices[vertex * stride];
+            memcpy(out, m.vertices.data(), m.nvertices * stride);
+            for (int v=0 ; v<m.nvertices ; v+=1) shift_vertex(out + v * stride, layout.pen[ix]);
+
+            for (int n=0 ; n<m.nindices ; n+=1) {
+                uint32_t i = m.wide_indices ? ((const uint32_t *) m.indices.data())[n]
+                                            : ((const uint16_t *) m.indices.data())[n];
+                if (merged.wide_indices) ((uint32_t *) merged.indices.data())[index + n] = vertex + i;
+                else ((uint16_t *) merged.indices.data())[index + n] = vertex + i;
+            }
+            vertex += m.nvertices;
+            index += m.nindices;
+        }
+        baked[lod] = arena.alloc(merged);
+    }
+    return true;
+}
+
+struct ext_text {
+    string text;
+    vector<char32_t> codepoints;
+    float width;
     float height;
-    float depth;
+    float depth = THICKNESS;
+    int font = 0;
     float mass;
     glm::vec3 color;
     rp3d::RigidBody * body;
-    glm::mat4 draw_transform = glm::translate(glm::mat4(1.0), glm::vec3(0,-0.5,0)); // TODO derive this from text geometry
+    vector<rp3d::ProxyShape *> proxies;
+    int pose_index;
+    aabb bounds; // body space, around the letters and so the collision box
+    word_layout letters;
+    glm::mat4 draw_transform; // layout space to body space, ink centered
+    bool bake = false;        // merge the letters into one mesh once laid out
+    bool baked = false;
+    mesh_ref baked_lods[NLODS];
+    bool sdf_ok = false;      // every letter is in the sdf atlas
+    bool sdf = false;         // drawn as sdf quads this frame
 
     ext_text() {}
-    ext_text(string text, float mass, glm::vec3 color, rp3d::Transform pose=rp3d::Transform());
-
+    ext_text(string text, float mass, glm::vec3 color, rp3d::Transform pose=rp3d::Transform(), bool bake=false,
+             float depth=THICKNESS, int font=0);
+
+    void layout(string newtext);
+    void add_shape();
+    void remove_shape();
+    void unbake();
+    void set_text(string newtext);
+    void refresh();
+    void destroy();
     void draw(glm::mat4 base_model);
 };
 
-ext_text::ext_text(string newtext, float newmass, glm::vec3 newcolor, rp3d::Transform pose) {
+// text and everything measured from it, in the current font and depth. glyph meshes
+// are made THICKNESS deep and stretched to it, --gpu-extrude extrudes to it
+void ext_text::layout(string newtext) {
+    text = newtext;
+    codepoints = decode_utf8(text);
+    letters = layout_word(codepoints, font);
+    width = letters.right - letters.left;
+    height = letters.top - letters.bot;
+    draw_transform = glm::translate(glm::mat4(1.0), glm::vec3(0, -(letters.top + letters.bot)/2, 0));
+    if (! gpu_extrude) draw_transform = glm::scale(draw_transform, glm::vec3(1, 1, depth / THICKNESS));
+
+    bounds = aabb();
+    bounds.add(glm::vec3(-width/2, -height/2, -depth/2));
+    bounds.add(glm::vec3(width/2, height/2, depth/2));
+    sdf_ok = sdf_text && font == 0 && sdf_font.covers(codepoints);
+
+    unbake();
+    baked = bake && ! gpu_extrude && ! letters.provisional && bake_word(codepoints, letters, baked_lods);
+}
+
+// box shapes are shared between bodies and never freed. extents are rounded
+// up to BOX_QUANTUM so the set of them stays small however much text goes by
+const float BOX_QUANTUM = 1.0 / 32;
+map<tuple<int, int, int>, rp3d::BoxShape *> box_shapes;
+
+// called with world_lock held
+rp3d::BoxShape * box_shape(float half_x, float half_y, float half_z) {
+    auto key = make_tuple(int(ceil(half_x / BOX_QUANTUM)), int(ceil(half_y / BOX_QUANTUM)), int(ceil(half_z / BOX_QUANTUM)));
+    rp3d::BoxShape * & shape = box_shapes[key];
+    if (! shape) {
+        shape = new rp3d::BoxShape(rp3d::Vector3(max(1, get<0>(key)) * BOX_QUANTUM,
+                                                 max(1, get<1>(key)) * BOX_QUANTUM,
+                                                 max(1, get<2>(key)) * BOX_QUANTUM));
+    }
+    return shape;
+}
+
+// a convex hull per glyph, extruded to the letter thickness. the outline's
+// control points bound its curves, so their hull holds the whole glyph.
+// rp3d keeps pointers into the arrays for the life of the shape, and like
+// the boxes these are never freed. words of other depths get the same
+// polyhedron scaled in z, one shape per depth rounded to BOX_QUANTUM
+struct glyph_hull {
+    vector<float> vertices;
+    vector<int> indices;
+    vector<rp3d::PolygonVertexArray::PolygonFace> faces;
+    rp3d::PolygonVertexArray * polygons = nullptr;
+    rp3d::PolyhedronMesh * polyhedron = nullptr;
+    rp3d::ConvexMeshShape * shape = nullptr; // null when there is no ink
+    map<int, rp3d::ConvexMeshShape *> deeper;
+    float area = 0;
+
+    rp3d::ConvexMeshShape * at_depth(float depth);
+};
+
+// called with world_lock held
+rp3d::ConvexMeshShape * glyph_hull::at_depth(float depth) {
+    int key = max(1, int(round(depth / BOX_QUANTUM)));
+    if (! shape || key == int(round(THICKNESS / BOX_QUANTUM))) return shape;
+    rp3d::ConvexMeshShape * & scaled = deeper[key];
+    if (! scaled) scaled = new rp3d::ConvexMeshShape(polyhedron, rp3d::Vector3(1, 1, key * BOX_QUANTUM / THICKNESS));
+    return scaled;
+}
+
+unordered_map<glyph_key, glyph_hull> glyph_hulls;
+
+// counterclockwise, by andrew's monotone chain
+vector<glm::vec2> convex_hull(vector<glm::vec2> points) {
+    sort(points.begin(), points.end(), [](glm::vec2 a, glm::vec2 b) {
+        return a.x < b.x || (a.x == b.x && a.y < b.y);
+    });
+    auto turn = [](glm::vec2 o, glm::vec2 a, glm::vec2 b) {
+        return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+    };
+
+    int n = points.size();
+    if (n < 3) return points;
+    vector<glm::vec2> hull(2 * n);
+    int k = 0;
+    for (int ix=0 ; ix<n ; ix+=1) {
+        while (k >= 2 && turn(hull[k-2], hull[k-1], points[ix]) <= 0) k -= 1;
+        hull[k++] = points[ix];
+    }
+    for (int ix=n-2, lower=k+1 ; ix>=0 ; ix-=1) {
+        while (k >= lower && turn(hull[k-2], hull[k-1], points[ix]) <= 0) k -= 1;
+        hull[k++] = points[ix];
+    }
+    hull.resize(k - 1);
+    return hull;
+}
+
+// called with world_lock held
+glyph_hull & get_glyph_hull(int font, char32_t c) {
+    auto found = glyph_hulls.find(key_of(font, c));
+    if (found != glyph_hulls.end()) return found->second;
+    glyph_hull & h = glyph_hulls[key_of(font, c)];
+
+    FT_Face face = layout_face(font);
+    if (FT_Load_Glyph(face, FT_Get_Char_Index(face, c), FT_LOAD_NO_SCALE)) die("glyph");
+    const FT_Outline & outline = face->glyph->outline;
+    float font_size = face->units_per_EM;
+    vector<glm::vec2> points;
+    for (int ix=0 ; ix<outline.n_points ; ix+=1) {
+        points.push_back(glm::vec2(outline.points[ix].x, outline.points[ix].y) / font_size);
+    }
+    vector<glm::vec2> hull = convex_hull(points);
+    int n = hull.size();
+    for (int ix=0 ; ix<n ; ix+=1) {
+        glm::vec2 a = hull[ix], b = hull[(ix+1) % n];
+        h.area += (a.x * b.y - b.x * a.y) / 2;
+    }
+    if (n < 3 || h.area <= 1e-6) return h;
+
+    // front cap vertices then back, front cap faces -z so runs clockwise
+    for (int z=0 ; z<2 ; z+=1) {
+        for (glm::vec2 p : hull) h.vertices.insert(h.vertices.end(), {p.x, p.y, (z - 0.5f) * THICKNESS});
+    }
+    auto face_from = [&](initializer_list<int> corners) {
+        h.faces.push_back({(unsigned int) corners.size(), (unsigned int) h.indices.size()});
+        h.indices.insert(h.indices.end(), corners);
+    };
+    h.faces.push_back({(unsigned int) n, 0});
+    for (int ix=n-1 ; ix>=0 ; ix-=1) h.indices.push_back(ix);
+    h.faces.push_back({(unsigned int) n, (unsigned int) n});
+    for (int ix=0 ; ix<n ; ix+=1) h.indices.push_back(n + ix);
+    for (int ix=0 ; ix<n ; ix+=1) {
+        int next = (ix+1) % n;
+        face_from({ix, next, n + next, n + ix});
+    }
+
+    h.polygons = new rp3d::PolygonVertexArray(2 * n, h.vertices.data(), 3 * sizeof(float),
+            h.indices.data(), sizeof(int), h.faces.size(), h.faces.data(),
+            rp3d::PolygonVertexArray::VertexDataType::VERTEX_FLOAT_TYPE,
+            rp3d::PolygonVertexArray::IndexDataType::INDEX_INTEGER_TYPE);
+    h.polyhedron = new rp3d::PolyhedronMesh(h.polygons);
+    h.shape = new rp3d::ConvexMeshShape(h.polyhedron);
+    return h;
+}
+
+// one box per word, or a compound of glyph hulls that follows the letters
+enum collider_mode { BOX_COLLIDERS, HULL_COLLIDERS };
+collider_mode colliders = BOX_COLLIDERS;
+long collision_shapes = 0; // proxies in the world
+
+// called with world_lock held. the mass is shared out by hull area
+void ext_text::add_shape() {
+    if (colliders == HULL_COLLIDERS) {
+        float area = 0;
+        for (char32_t c : codepoints) if (c != '\0') area += get_glyph_hull(font, c).area;
+        float y = -(letters.top + letters.bot) / 2;
+        for (int ix=0 ; ix<(int) codepoints.size() ; ix+=1) {
+            if (codepoints[ix] == '\0') continue;
+            glyph_hull & h = get_glyph_hull(font, codepoints[ix]);
+            if (! h.shape) continue;
+            rp3d::Transform offset(rp3d::Vector3(letters.pen[ix], y, 0), rp3d::Quaternion::identity());
+            proxies.push_back(body->addCollisionShape(h.at_depth(depth), offset, mass * h.area / area));
+        }
+    }
+
+    // boxes, and words with no ink at all
+    if (proxies.empty()) {
+        proxies.push_back(body->addCollisionShape(box_shape(width/2, height/2, depth/2), rp3d::Transform(), mass));
+    }
+    collision_shapes += proxies.size();
+}
+
+// called with world_lock held
+void ext_text::remove_shape() {
+    for (auto * proxy : proxies) body->removeCollisionShape(proxy);
+    collision_shapes -= proxies.size();
+    proxies.clear();
+}
+
+// gives the merged meshes of a baked word back to the arena
+void ext_text::unbake() {
+    if (baked) {
+        for (int lod=0 ; lod<NLODS ; lod+=1) arena.release(baked_lods[lod]);
+    }
+    baked = false;
+}
+
+ext_text::ext_text(string newtext, float newmass, glm::vec3 newcolor, rp3d::Transform pose, bool newbake, float newdepth, int newfont) {
     //cout << "creating ext_text" << endl;
 
-    text = newtext;
-    width = word_width(text);
-    //height = word_height(text);
-    height = 0.667; // TODO derive this from text geometry
-    depth = THICKNESS;
+    bake = newbake;
+    depth = newdepth;
+    font = newfont;
+    layout(newtext);
     mass = newmass;
     color = newcolor;
 
     //cout << "creating rigidbody" << endl;
 
-    body = world->createRigidBody(pose);
-    body->setLinearDamping(0.01);
-    body->setAngularDamping(0.01);
-
-    //cout << "creating collisionshape" << endl;
+    {
+        lock_guard<world_mutex> guard(world_lock);
+        body = world->createRigidBody(pose);
+        body->setLinearDamping(0.01);
+        body->setAngularDamping(0.01);
+        add_shape();
+    }
+    pose_index = track_body(body);
 
-    rp3d::CollisionShape * shape = new rp3d::BoxShape(rp3d::Vector3(width/2, height/2, depth/2));
+    //cout << "done creating ext_text" << endl;
+}
 
-    //cout << "adding collisionshape" << endl;
+// new text on the same body, which keeps its motion and springs
+void ext_text::set_text(string newtext) {
+    layout(newtext);
 
-    body->addCollisionShape(shape, rp3d::Transform(), mass);
+    lock_guard<world_mutex> guard(world_lock);
+    remove_shape();
+    add_shape();
+}
 
-    //cout << "done creating ext_text" << endl;
+// once the glyphs a layout waited on have arrived, lay it out for real
+void ext_text::refresh() {
+    if (letters.provisional && letters.generation != glyph_generation) set_text(text);
 }
 
+// small words are drawn as sdf quads, switching with some hysteresis
 void ext_text::draw(glm::mat4 base_model) {
-    glm::mat4 model;
-    body->getTransform().getOpenGLMatrix(glm::value_ptr(model));
-    model = base_model * model * draw_transform;
-    draw_word(text, model, color);
+    glm::mat4 model = base_model * body_model(pose_index) * draw_transform;
+    float pixels = pixels_per_em(model);
+    sdf = sdf_ok && pixels < (sdf ? SDF_LEAVE : SDF_ENTER);
+    if (sdf) {
+        draw_word_sdf(codepoints, letters, model, color);
+        stats.words_sdf += 1;
+        return;
+    }
+
+    int lod = pick_lod(pixels);
+    if (baked) frame_draws.add(baked_lods[lod], model, normal_matrix(model), color);
+    else draw_word(codepoints, letters, model, color, lod, depth);
 }
 
 vector<ext_text> words;
-vector<spring> springs;
+spring_system springs;
+
+// the body goes, and with it any springs attached to it
+void ext_text::destroy() {
+    {
+        lock_guard<world_mutex> guard(world_lock);
+        springs.remove(body);
+        collision_shapes -= proxies.size();
+        untrack_body_locked(pose_index);
+        world->destroyRigidBody(body);
+    }
+    unbake();
+}
+
+// must match color_hash in gen_colors.cc
+constexpr uint32_t color_hash(const char * name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ (seed * 16777619u);
+    for ( ; *name ; name += 1) {
+        hash ^= (unsigned char) *name;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+constexpr bool same_name(const char * a, const char * b) {
+    while (*a && *a == *b) {
+        a += 1;
+        b += 1;
+    }
+    return *a == *b;
+}
+
+// slot in color_table of the X11 color of this name, or -1
+constexpr int color_slot(const char * name) {
+    uint32_t seed = color_seeds[color_hash(name, 0) % COLOR_BUCKETS];
+    int slot = color_hash(name, seed) % COLOR_SLOTS;
+    const char * found = color_table[slot].name;
+    return found && same_name(found, name) ? slot : -1;
+}
+
+static_assert(color_slot("aliceblue") >= 0 && color_slot("alicebleu") < 0, "color table out of date");
+
+const named_color * find_color(const char * name) {
+    int slot = color_slot(name);
+    return slot < 0 ? nullptr : & color_table[slot];
+}
+
+// __index of the lua globals: an unknown global naming a color becomes a
+// {red, green, blue} table, kept as a real global from then on
+int lua_color_index(lua_State * L) {
+    if (lua_type(L, 2) != LUA_TSTRING) return 0;
+    const named_color * c = find_color(lua_tostring(L, 2));
+    if (! c) return 0;
+
+    lua_createtable(L, 0, 3);
+    lua_pushnumber(L, c->red);
+    lua_setfield(L, -2, "red");
+    lua_pushnumber(L, c->green);
+    lua_setfield(L, -2, "green");
+    lua_pushnumber(L, c->blue);
+    lua_setfield(L, -2, "blue");
+
+    lua_pushvalue(L, 2);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, 1);
+    return 1;
+}
+
+void expose_colors(lua_State * L) {
+    lua_pushglobaltable(L);
+    lua_createtable(L, 0, 1);
+    lua_pushcfunction(L, lua_color_index);
+    lua_setfield(L, -2, "__index");
+    lua_setmetatable(L, -2);
+    lua_pop(L, 1);
+}
 
-void setup_scene() {
-    //cout << "setting up scene" << endl;
+// bytecode cache files start with this, then the fnv1a hash of the source
+// they were compiled from
+const char LUA_CACHE_MAGIC[8] = {'t', '3', 'd', 'l', 'u', 'a', 'c', '1'};
+const size_t LUA_CACHE_HEADER = sizeof(LUA_CACHE_MAGIC) + sizeof(uint64_t);
 
-    rp3d::Vector3 gravity(0.0, -9.81, 0.0);
-    world = new rp3d::DynamicsWorld(gravity);
+bool lua_cache = true;
 
-    // read words from Lua file
-    lua_State * L = luaL_newstate();
+int append_chunk(lua_State * L, const void * data, size_t size, void * user) {
+    ((string *) user)->append((const char *) data, size);
+    return 0;
+}
 
-    //TODO use lua function to read file
-    ifstream luargb("rgb.lua");
-    string line;
-    while (! luargb.eof()) {
-        getline(luargb, line);
-        int error = luaL_loadstring(L, line.c_str()) || lua_pcall(L, 0, 0, 0);
-        if (error) die("lua");
+// loads a whole lua file as one chunk and runs it. the compiled chunk is
+// kept next to it in filename + "c" and used while the source is unchanged,
+// cached says if it came from there. false with the reason in error if the
+// file can't be read, compiled or run
+bool run_lua_file(lua_State * L, string filename, bool & cached, string & error) {
+    string source = read_file(filename);
+    if (source.empty()) {
+        error = "can't read " + filename;
+        return false;
+    }
+    uint64_t source_hash = fnv1a(source.data(), source.size());
+    string chunk_name = "@" + filename;
+    string cache_name = filename + "c";
+
+    // lua rejects bytecode from another version or build, that is a miss too
+    cached = false;
+    if (lua_cache) {
+        string cache = read_file(cache_name);
+        if (cache.size() > LUA_CACHE_HEADER
+            && memcmp(cache.data(), LUA_CACHE_MAGIC, sizeof(LUA_CACHE_MAGIC)) == 0
+            && memcmp(cache.data() + sizeof(LUA_CACHE_MAGIC), & source_hash, sizeof(source_hash)) == 0) {
+            cached = luaL_loadbufferx(L, cache.data() + LUA_CACHE_HEADER, cache.size() - LUA_CACHE_HEADER,
+                                      chunk_name.c_str(), "b") == LUA_OK;
+            if (! cached) lua_pop(L, 1);
+        }
     }
-    luargb.close();
 
-    //cout << "done reading colors" << endl;
+    if (! cached) {
+        if (luaL_loadbufferx(L, source.data(), source.size(), chunk_name.c_str(), "t") != LUA_OK) {
+            error = lua_tostring(L, -1);
+            return false;
+        }
+        if (lua_cache) {
+            string cache(LUA_CACHE_MAGIC, sizeof(LUA_CACHE_MAGIC));
+            cache.append((const char *) & source_hash, sizeof(source_hash));
+            lua_dump(L, append_chunk, & cache, 0);
+            ofstream out(cache_name, ios::binary);
+            out.write(cache.data(), cache.size());
+        }
+    }
 
-    ifstream luaconf("text3d_conf.lua");
-    while (! luaconf.eof()) {
-        getline(luaconf, line);
-        int error = luaL_loadstring(L, line.c_str()) || lua_pcall(L, 0, 0, 0);
-        if (error) die("lua");
+    if (lua_pcall(L, 0, 0, 0) != LUA_OK) {
+        error = lua_tostring(L, -1);
+        return false;
     }
-    luaconf.close();
+    return true;
+}
 
-    //cout << "done reading conf.lua" << endl;
+const char CONFIG_FILE[] = "text3d_conf.lua";
 
-    rp3d::RigidBody * prevbody = nullptr;
+// one entry of the words, colors, depths and fonts lists
+struct word_spec {
+    string text;
+    glm::vec3 color;
+    float depth = THICKNESS;
+    int font = 0;
+};
+
+// runs the config and reads its words, colors, depths and fonts. false with
+// the reason in error if it doesn't run, words isn't a list of strings or a
+// font won't load
+bool read_config(vector<word_spec> & specs, string & error) {
+    stage_timer timer("load_config");
+    auto start = chrono::steady_clock::now();
+
+    lua_State * L = luaL_newstate();
+    expose_colors(L);
+    bool cached;
+    bool ok = run_lua_file(L, CONFIG_FILE, cached, error);
+
+    //cout << "done reading conf.lua" << endl;
 
     //cout << "setting up words" << endl;
 
     lua_getglobal(L, "words");
-    int nwords = luaL_len(L, -1);
+    if (ok && ! lua_istable(L, -1)) {
+        error = "words is not a list";
+        ok = false;
+    }
+    int nwords = ok ? luaL_len(L, -1) : 0;
     lua_pop(L, 1);
-    for (int n=1 ; n<=nwords ; n+=1) {
-        //cout << "setting up a word" << endl;
-        //cout << "stack:" << lua_gettop(L) << endl;
 
+    specs.clear();
+    for (int n=1 ; ok && n<=nwords ; n+=1) {
         lua_getglobal(L, "words");
         lua_geti(L, -1, n);
-        string text(lua_tostring(L, -1));
+        if (! lua_isstring(L, -1)) {
+            error = "words[" + to_string(n) + "] is not a string";
+            ok = false;
+        }
+        word_spec spec;
+        if (ok) spec.text = lua_tostring(L, -1);
         lua_pop(L, 2);
 
         //cout << "word is " << text << endl;
 
-        glm::vec3 color;
+        // missing colors and components are black
+        spec.color = glm::vec3(0, 0, 0);
         lua_getglobal(L, "colors");
-        lua_geti(L, -1, n);
-
-        lua_getfield(L, -1, "red");
-        color[0] = lua_tonumber(L, -1);
+        if (lua_istable(L, -1)) {
+            lua_geti(L, -1, n);
+            if (lua_istable(L, -1)) {
+                const char * names[] = {"red", "green", "blue"};
+                for (int c=0 ; c<3 ; c+=1) {
+                    lua_getfield(L, -1, names[c]);
+                    spec.color[c] = lua_tonumber(L, -1);
+                    lua_pop(L, 1);
+                }
+            }
+            lua_pop(L, 1);
+        }
         lua_pop(L, 1);
 
-        lua_getfield(L, -1, "green");
-        color[1] = lua_tonumber(L, -1);
+        // depths are optional, missing or silly ones are THICKNESS
+        lua_getglobal(L, "depths");
+        if (lua_istable(L, -1)) {
+            lua_geti(L, -1, n);
+            if (lua_isnumber(L, -1) && lua_tonumber(L, -1) > 0) spec.depth = lua_tonumber(L, -1);
+            lua_pop(L, 1);
+        }
         lua_pop(L, 1);
 
-        lua_getfield(L, -1, "blue");
-        color[2] = lua_tonumber(L, -1);
+        // fonts are optional too, by file name, missing ones are FONT_FILE
+        lua_getglobal(L, "fonts");
+        if (ok && lua_istable(L, -1)) {
+            lua_geti(L, -1, n);
+            if (lua_isstring(L, -1)) {
+                string file = lua_tostring(L, -1);
+                spec.font = font_id(file);
+                if (spec.font < 0) {
+                    error = "fonts[" + to_string(n) + "]: can't load " + file;
+                    ok = false;
+                }
+            }
+            lua_pop(L, 1);
+        }
         lua_pop(L, 1);
 
-        lua_pop(L, 2);
+        specs.push_back(spec);
+    }
 
-        ext_text word = ext_text(text, 1, color, rp3d::Transform(rp3d::Vector3(n, -n, 0), rp3d::Quaternion::identity()));
-        words.push_back(word);
+    lua_close(L);
 
-        //cout << "done setting up a word" << endl;
-        //cout << "stack:" << lua_gettop(L) << endl;
+    if (ok) {
+        cout << "config loaded in " << seconds_since(start) * 1000 << " ms"
+             << (cached ? " (bytecode cache)" : "") << endl;
+    }
+    return ok;
+}
 
-        spring s;
-        float y = prevbody == nullptr ? 3.5 : -0.333;
-        s = {prevbody, rp3d::Vector3(-1.5,y,0),
-             word.body, rp3d::Vector3(-1.5,.333,0),
-             200, 0.5};
-        springs.push_back(s);
-        s = {prevbody, rp3d::Vector3(1.5,y,0),
-             word.body, rp3d::Vector3(1.5,.333,0),
-             200, 0.5};
-        springs.push_back(s);
+// appends a word to the chain, hanging from the one before or from the
+// fixed anchor above the first
+void add_word(const word_spec & spec) {
+    int n = words.size() + 1;
+    rp3d::RigidBody * prevbody = words.empty() ? nullptr : words.back().body;
+
+    ext_text word = ext_text(spec.text, 1, spec.color, rp3d::Transform(rp3d::Vector3(n, -n, 0), rp3d::Quaternion::identity()),
+                           bake_words, spec.depth, spec.font);
+    words.push_back(word);
+
+    //cout << "done setting up a word" << endl;
+
+    lock_guard<world_mutex> guard(world_lock);
+    spring s;
+    float y = prevbody == nullptr ? 3.5 : -0.333;
+    s = {prevbody, rp3d::Vector3(-1.5,y,0),
+         word.body, rp3d::Vector3(-1.5,.333,0),
+         200, 0.5};
+    springs.add(s);
+    s = {prevbody, rp3d::Vector3(1.5,y,0),
+         word.body, rp3d::Vector3(1.5,.333,0),
+         200, 0.5};
+    springs.add(s);
+
+    //cout << "done setting up its springs" << endl;
+}
 
-        //cout << "done setting up its springs" << endl;
+void setup_scene() {
+    //cout << "setting up scene" << endl;
 
-        prevbody = word.body;
-    }
+    rp3d::Vector3 gravity(0.0, -9.81, 0.0);
+    world = new rp3d::DynamicsWorld(gravity);
 
-    lua_close(L);
+    // read words from Lua file
+    vector<word_spec> specs;
+    string error;
+    if (! read_config(specs, error)) die("lua: " + error);
+    for (auto & spec : specs) add_word(spec);
 
     // setup teapot
     rp3d::Transform pose(rp3d::Vector3(0, 0, 0), rp3d::Quaternion::identity());
@@ -755,105 +4412,1053 @@ void setup_scene() {
     teapot_body->setLinearDamping(0.01);
     teapot_body->setAngularDamping(0.01);
 
-    rp3d::CollisionShape * shape = new rp3d::BoxShape(rp3d::Vector3(1, 1, 1));
+    // a box around the mesh as it is drawn
+    aabb box = teapot_bounds.transformed(teapot_model());
+    glm::vec3 center = box.center();
+    glm::vec3 extent = box.extent();
     float mass = 10.0;
-    teapot_body->addCollisionShape(shape, rp3d::Transform(), mass);
+    teapot_body->addCollisionShape(box_shape(extent.x, extent.y, extent.z),
+                                   rp3d::Transform(rp3d::Vector3(center.x, center.y, center.z), rp3d::Quaternion::identity()),
+                                   mass);
+    collision_shapes += 1;
+    teapot_pose = track_body(teapot_body);
 
     spring s = {nullptr, rp3d::Vector3(-1.5,1,0),
                 teapot_body, rp3d::Vector3(-1.5,.333,0),
                 200, 1.0};
-    springs.push_back(s);
+    springs.add(s);
 
     //cout << "done setting up scene" << endl;
 }
 
+// brings the live words in line with the config. words are matched by
+// position, which is also the order they hang from each other in, so only
+// the tail of the chain is ever created or destroyed. everything else keeps
+// its body and its motion
+void reload_config() {
+    vector<word_spec> specs;
+    string error;
+    if (! read_config(specs, error)) {
+        cout << "config not reloaded: " << error << endl;
+        return;
+    }
+
+    int recolored = 0, retexted = 0, added = 0, removed = 0;
+    int nkept = min(words.size(), specs.size());
+    for (int ix=0 ; ix<nkept ; ix+=1) {
+        ext_text & word = words[ix];
+        if (word.text != specs[ix].text || word.depth != specs[ix].depth || word.font != specs[ix].font) {
+            word.depth = specs[ix].depth;
+            word.font = specs[ix].font;
+            word.set_text(specs[ix].text);
+            retexted += 1;
+        }
+        if (word.color != specs[ix].color) {
+            word.color = specs[ix].color;
+            recolored += 1;
+        }
+    }
+    while (words.size() > specs.size()) {
+        words.back().destroy();
+        words.pop_back();
+        removed += 1;
+    }
+    while (words.size() < specs.size()) {
+        add_word(specs[words.size()]);
+        added += 1;
+    }
+
+    cout << "config reloaded: " << retexted << " retexted, " << recolored << " recolored, "
+         << added << " added, " << removed << " removed" << endl;
+}
+
+// notices when a file has been written. inotify on linux, elsewhere its
+// modification time is checked once a second
+struct file_watch {
+    string filename;
+#ifdef __linux__
+    int fd = -1;
+#else
+    time_t mtime = 0;
+    double next_check = 0;
+#endif
+
+    void watch(string name);
+    bool changed();
+};
+
+// modification time, 0 if it can't be read
+time_t file_mtime(string filename) {
+    struct stat info;
+    return stat(filename.c_str(), & info) == 0 ? info.st_mtime : 0;
+}
+
+#ifdef __linux__
+// the directory is watched, editors often save by renaming a new file over
+// the old one
+void file_watch::watch(string name) {
+    filename = name;
+    size_t slash = filename.rfind('/');
+    string dir = slash == string::npos ? "." : filename.substr(0, slash);
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        cout << "not watching " << filename << " for changes" << endl;
+    }
+}
+
+bool file_watch::changed() {
+    if (fd < 0) return false;
+    string base = filename.substr(filename.rfind('/') + 1);
+
+    // drain everything queued, several events per save are common
+    bool hit = false;
+    alignas(inotify_event) char buffer[4096];
+    ssize_t size;
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (char * p = buffer ; p < buffer + size ; ) {
+            auto * event = (inotify_event *) p;
+            if (event->len && base == event->name) hit = true;
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+    return hit;
+}
+#else
+void file_watch::watch(string name) {
+    filename = name;
+    mtime = file_mtime(filename);
+}
+
+bool file_watch::changed() {
+    double now = profile_now();
+    if (now < next_check) return false;
+    next_check = now + 1.0;
+
+    time_t latest = file_mtime(filename);
+    if (latest == 0 || latest == mtime) return false;
+    mtime = latest;
+    return true;
+}
+#endif
+
+file_watch config_watch;
+
+// --stream FILE: words read from a file or pipe, "-" for stdin, rain down on
+// the scene and expire. they live in a fixed pool of slots whose bodies are
+// made once and recycled, oldest first when the pool is full, and any that
+// are older than stream_ttl seconds are put away
+string stream_source;
+int stream_cap = 500;
+float stream_ttl = 10;
+
+// reads words on its own thread. the read blocks, so the thread is never
+// joined and the reader is never freed
+struct stream_reader {
+    thread worker;
+    mutex lock;
+    deque<string> pending;
+    long dropped = 0;
+
+    void run(istream * in);
+    void take(deque<string> & out);
+};
+
+// words that arrive faster than they can be spawned are dropped, oldest first
+void stream_reader::run(istream * in) {
+    name_thread("stream reader");
+    string text;
+    while (*in >> text) {
+        lock_guard<mutex> guard(lock);
+        pending.push_back(move(text));
+        if ((int) pending.size() > stream_cap) {
+            pending.pop_front();
+            dropped += 1;
+        }
+    }
+}
+
+void stream_reader::take(deque<string> & out) {
+    lock_guard<mutex> guard(lock);
+    out.swap(pending);
+    pending.clear();
+}
+
+struct stream_slot {
+    ext_text word;
+    double born;
+};
+
+struct stream_pool {
+    vector<stream_slot> slots;
+    vector<int> free_slots;
+    deque<int> live; // oldest first
+    deque<string> arrived;
+    mt19937 rng;
+    long spawned = 0;
+    long expired = 0;
+    long evicted = 0;
+
+    void spawn(const string & text);
+    void retire(int ix);
+    void update();
+};
+
+stream_reader * reader = nullptr;
+stream_pool stream;
+
+void start_stream() {
+    istream * in = & cin;
+    if (stream_source != "-") {
+        in = new ifstream(stream_source);
+        if (! *in) die("can't read " + stream_source);
+    }
+    reader = new stream_reader;
+    reader->worker = thread(& stream_reader::run, reader, in);
+    reader->worker.detach();
+
+    stream.slots.reserve(stream_cap);
+}
+
+// a new word above the view, in a random named color with a little spin
+void stream_pool::spawn(const string & text) {
+    int ix;
+    if (! free_slots.empty()) {
+        ix = free_slots.back();
+        free_slots.pop_back();
+    } else if ((int) slots.size() < stream_cap) {
+        ix = -1;
+    } else {
+        ix = live.front();
+        live.pop_front();
+        evicted += 1;
+    }
+
+    uniform_real_distribution<float> spread(-3, 3);
+    uniform_real_distribution<float> spin(-2, 2);
+    const named_color * c;
+    do c = & color_table[rng() % COLOR_SLOTS]; while (! c->name);
+    glm::vec3 color(c->red, c->green, c->blue);
+    rp3d::Transform pose(rp3d::Vector3(spread(rng), 4.5, 0), rp3d::Quaternion::identity());
+    rp3d::Vector3 angular(spin(rng), spin(rng), spin(rng));
+
+    if (ix < 0) {
+        ix = slots.size();
+        slots.push_back({ext_text(text, 1, color, pose), 0});
+        lock_guard<world_mutex> guard(world_lock);
+        slots[ix].word.body->setAngularVelocity(angular);
+    } else {
+        ext_text & word = slots[ix].word;
+        word.set_text(text);
+        word.color = color;
+
+        lock_guard<world_mutex> guard(world_lock);
+        word.body->setTransform(pose);
+        word.body->setLinearVelocity(rp3d::Vector3(0, 0, 0));
+        word.body->setAngularVelocity(angular);
+        word.body->setIsActive(true);
+        teleport_body(word.pose_index);
+    }
+
+    slots[ix].born = profile_now();
+    live.push_back(ix);
+    spawned += 1;
+}
+
+// out of the simulation and back in the pool, the body is kept
+void stream_pool::retire(int ix) {
+    {
+        lock_guard<world_mutex> guard(world_lock);
+        slots[ix].word.body->setIsActive(false);
+    }
+    free_slots.push_back(ix);
+}
+
+// called once per frame on the render thread
+void stream_pool::update() {
+    double now = profile_now();
+    while (! live.empty() && now - slots[live.front()].born > stream_ttl) {
+        retire(live.front());
+        live.pop_front();
+        expired += 1;
+    }
+
+    reader->take(arrived);
+    for (auto & text : arrived) spawn(text);
+    arrived.clear();
+}
+
+void write_bench_report() {
+    ofstream out(bench_out);
+    if (! out) die("can't write " + bench_out);
+
+    out << "{\n";
+    out << "  \"frames\": " << bench_frames << ",\n";
+    out << "  \"renderer\": \"" << json_escape((const char *) glGetString(GL_RENDERER)) << "\",\n";
+    out << "  \"stages_ms\": {";
+    bool first = true;
+    for (auto & item : stage_times) {
+        vector<double> times = item.second;
+        sort(times.begin(), times.end());
+        int n = times.size();
+        double total = 0;
+        for (double t : times) total += t;
+        double median = n % 2 ? times[n/2] : (times[n/2 - 1] + times[n/2]) / 2;
+        double p99 = times[min(n-1, (int) ceil(0.99 * n) - 1)];
+
+        out << (first ? "\n" : ",\n");
+        out << "    \"" << json_escape(item.first) << "\": {\"calls\": " << n
+            << ", \"total\": " << total * 1000
+            << ", \"min\": " << times[0] * 1000
+            << ", \"median\": " << median * 1000
+            << ", \"p99\": " << p99 * 1000
+            << ", \"max\": " << times[n-1] * 1000 << "}";
+        first = false;
+    }
+    out << "\n  },\n";
+    out << "  \"words_drawn_per_frame\": " << stats_total.words_drawn / double(bench_frames) << ",\n";
+    out << "  \"words_culled_per_frame\": " << stats_total.words_culled / double(bench_frames) << ",\n";
+    out << "  \"words_sdf_per_frame\": " << stats_total.words_sdf / double(bench_frames) << ",\n";
+    out << "  \"teapot_culled_frames\": " << stats_total.teapots_culled << ",\n";
+    out << "  \"colliders\": {\"mode\": \"" << (colliders == HULL_COLLIDERS ? "hull" : "box")
+        << "\", \"shapes\": " << collision_shapes << "},\n";
+    out << "  \"glyphs\": {\"hits\": " << glyph_stats.hits << ", \"misses\": " << glyph_stats.misses
+        << ", \"evictions\": " << glyph_stats.evictions << ", \"resident_bytes\": " << glyph_stats.resident_bytes
+        << ", \"peak_bytes\": " << glyph_stats.peak_bytes << ", \"budget_bytes\": " << glyph_budget
+        << ", \"fonts\": " << nfonts << "},\n";
+    out << "  \"upload_ring\": {\"mode\": \"" << (persistent_uploads ? "persistent" : "orphan")
+        << "\", \"region_bytes\": " << uploads.region_size << ", \"peak_frame_bytes\": " << uploads.peak_bytes
+        << ", \"fence_waits\": " << uploads.fence_waits << ", \"wait_ms\": " << uploads.wait_seconds * 1000
+        << ", \"grows\": " << uploads.grows << "}";
+    if (reader) {
+        lock_guard<mutex> guard(reader->lock);
+        out << ",\n  \"stream\": {\"spawned\": " << stream.spawned << ", \"expired\": " << stream.expired
+            << ", \"evicted\": " << stream.evicted << ", \"dropped\": " << reader->dropped
+            << ", \"pool_slots\": " << stream.slots.size() << "}";
+    }
+    out << "\n";
+    out << "}\n";
+
+    cout << "bench report written to " << bench_out << endl;
+}
+
+// body transforms after some number of physics steps
+struct physics_snapshot {
+    double time = 0; // simulated seconds since the physics thread started
+    vector<rp3d::Transform> poses;
+    vector<uint32_t> generations;
+};
+
+// one writer, one reader, with no lock between them. the writer fills back
+// and swaps it into middle, the reader swaps front out of middle when the
+// writer has put something newer there. the reader never waits; the writer
+// publishes under world_lock, so it can wait on edits, but never on reads
+struct snapshot_buffer {
+    static const int FRESH = 4;
+
+    physics_snapshot slots[3];
+    atomic<int> middle{1};
+    int back = 0;
+    int front = 2;
+
+    physics_snapshot & write_slot() { return slots[back]; }
+    void publish() { back = middle.exchange(back | FRESH) & ~FRESH; }
+
+    bool acquire() {
+        if (! (middle.load() & FRESH)) return false;
+        front = middle.exchange(front) & ~FRESH;
+        return true;
+    }
+    const physics_snapshot & read_slot() const { return slots[front]; }
+};
+
 float time_step = 1.0 / 1000.0;
+
+// after a stall, drop simulated time beyond this instead of trying to
+// catch it all up at once
+const double MAX_CATCH_UP = 0.25;
+
+// fixed step simulation on its own thread, paced against the wall clock
+struct physics_thread {
+    thread worker;
+    atomic<bool> stopping{false};
+    snapshot_buffer snapshots;
+    chrono::steady_clock::time_point start;
+    double sim_time = 0;
+
+    void begin(bool threaded);
+    void step(int nsteps);
+    void publish();
+    void run();
+    void stop();
+};
+
+// called with world_lock held
+void physics_thread::publish() {
+    physics_snapshot & snap = snapshots.write_slot();
+    snap.time = sim_time;
+    snap.poses.resize(tracked_bodies.size());
+    snap.generations = tracked_generations;
+    for (size_t ix=0 ; ix<tracked_bodies.size() ; ix+=1) {
+        if (tracked_bodies[ix]) snap.poses[ix] = tracked_bodies[ix]->getTransform();
+    }
+    snapshots.publish();
+}
+
+// takes world_lock for each substep rather than the whole batch, so render
+// side edits (spawning, retiring, new text, reloads) get in between the
+// substeps of a long catch-up
+void physics_thread::step(int nsteps) {
+    for (int n=0 ; n<nsteps ; n+=1) {
+        world_lock.let_waiters_in();
+        lock_guard<world_mutex> guard(world_lock);
+        stage_timer timer("physics_substep");
+        {
+            stage_timer spring_timer("spring_forces");
+            springs.apply_forces();
+        }
+        {
+            stage_timer update_timer("world_update");
+            world->update(time_step);
+        }
+        sim_time += time_step;
+    }
+    lock_guard<world_mutex> guard(world_lock);
+    publish();
+}
+
+// publishes the starting state, then without the thread the caller steps
+// with physics_step
+void physics_thread::begin(bool threaded) {
+    start = chrono::steady_clock::now();
+    {
+        lock_guard<world_mutex> guard(world_lock);
+        publish();
+    }
+    if (threaded) worker = thread(& physics_thread::run, this);
+}
+
+void physics_thread::run() {
+    name_thread("physics");
+    while (! stopping) {
+        double now = seconds_since(start);
+        if (now - sim_time > MAX_CATCH_UP) sim_time = now - MAX_CATCH_UP;
+        if (now - sim_time < time_step) {
+            this_thread::sleep_for(chrono::duration<double>(sim_time + time_step - now));
+            continue;
+        }
+
+        step(int((now - sim_time) / time_step));
+    }
+}
+
+void physics_thread::stop() {
+    stopping = true;
+    if (worker.joinable()) worker.join();
+}
+
+physics_thread physics;
+
+void stop_physics() {
+    physics.stop();
+}
+
+// step forward dt on the calling thread, for runs without the physics thread
 void physics_step(float dt) {
-    for (float n=0 ; n<dt ; n+=time_step) {
-        for (auto spring : springs) spring.apply_force();
+    stage_timer timer("physics_step");
+    physics.step(lround(dt / time_step));
+}
+
+// the render thread's view of the simulation: the two newest snapshots it
+// has acquired, and every tracked body's model matrix for this frame
+struct render_poses {
+    physics_snapshot prev;
+    physics_snapshot curr;
+    vector<glm::mat4> models;
+};
 
-        world->update(time_step);
+render_poses poses;
+
+// called once per frame on the render thread. draws one publish interval
+// behind the newest state, so there is a snapshot on either side to blend
+void interpolate_poses() {
+    if (physics.snapshots.acquire()) {
+        swap(poses.prev, poses.curr);
+        poses.curr = physics.snapshots.read_slot();
+    }
+
+    // without the physics thread there is nothing to catch up with, draw
+    // the newest state as is
+    double interval = poses.curr.time - poses.prev.time;
+    double behind = seconds_since(physics.start) - poses.curr.time;
+    float alpha = 1.0;
+    if (physics.worker.joinable() && interval > 0) alpha = min(1.0, max(0.0, behind / interval));
+
+    poses.models.resize(poses.curr.poses.size());
+    for (size_t ix=0 ; ix<poses.curr.poses.size() ; ix+=1) {
+        rp3d::Transform pose = poses.curr.poses[ix];
+        if (ix < poses.prev.poses.size() && poses.prev.generations[ix] == poses.curr.generations[ix]) {
+            pose = rp3d::Transform::interpolateTransforms(poses.prev.poses[ix], pose, alpha);
+        }
+        pose.getOpenGLMatrix(glm::value_ptr(poses.models[ix]));
     }
 }
 
+// bodies tracked since the last snapshot stay at the origin until it arrives
+glm::mat4 body_model(int pose_index) {
+    if (pose_index < (int) poses.models.size()) return poses.models[pose_index];
+    return glm::mat4(1.0);
+}
+
 void draw_scene() {
     glUseProgram(shaderProgram);
-    unsigned int projectionLoc = glGetUniformLocation(shaderProgram, "projection");
-    unsigned int viewLoc = glGetUniformLocation(shaderProgram, "view");
-    unsigned int lightPosLoc = glGetUniformLocation(shaderProgram, "lightPos");
-    unsigned int lightColorLoc = glGetUniformLocation(shaderProgram, "lightColor");
 
     auto projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniformMatrix4fv(scene_locs.projection, 1, GL_FALSE, glm::value_ptr(projection));
 
     auto view = glm::mat4(1.0f);
     view = glm::translate(view, glm::vec3(0.0, 0.0, -4.0));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(scene_locs.view, 1, GL_FALSE, glm::value_ptr(view));
+
+    camera = {projection, view};
+
+    glUniform3f(scene_locs.light_pos, 1.0, 1.0, -1.0);
+    glUniform3f(scene_locs.light_color, 1.0, 1.0, 1.0);
 
-    glUniform3f(lightPosLoc, 1.0, 1.0, -1.0);
-    glUniform3f(lightColorLoc, 1.0, 1.0, 1.0);
+    // cull before any per letter work
+    frustum view_frustum(projection * view);
+    stats = scene_stats();
 
     auto base_model = glm::mat4(1.0);
-    for (auto word : words) word.draw(base_model);
+    auto draw_visible = [&](ext_text & word) {
+        glm::mat4 model = base_model * body_model(word.pose_index);
+        if (! view_frustum.visible(word.bounds.transformed(model))) {
+            stats.words_culled += 1;
+            return;
+        }
+        stats.words_drawn += 1;
+        word.draw(base_model);
+    };
+    for (auto & word : words) draw_visible(word);
+    for (int ix : stream.live) draw_visible(stream.slots[ix].word);
 
     //TODO bounce teapot
-    draw_teapot();
+    draw_teapot(view_frustum);
+
+    frame_draws.submit();
+    if (gpu_extrude) extrude_draws.submit(projection, view);
+    sdf_draws.submit(projection, view);
+    stats_total.add(stats);
+}
+
+int frame = 0;
+
+void parse_args(int nargs, char * args[]) {
+    for (int ix=1 ; ix<nargs ; ix+=1) {
+        string arg = args[ix];
+        if (arg == "--glyph-threads" && ix+1 < nargs) glyph_threads = stoi(args[++ix]);
+        else if (arg == "--glyph-timing") glyph_timing = true;
+        else if (arg == "--no-indirect") multi_draw_indirect = false;
+        else if (arg == "--no-persistent-map") persistent_uploads = false;
+        else if (arg == "--half-positions") half_positions = true;
+        else if (arg == "--teapot-fineness" && ix+1 < nargs) teapot_fineness = max(2, stoi(args[++ix]));
+        else if (arg == "--bench" && ix+1 < nargs) bench_frames = max(1, stoi(args[++ix]));
+        else if (arg == "--bench-out" && ix+1 < nargs) bench_out = args[++ix];
+        else if (arg == "--record" && ix+1 < nargs) record_frames = max(1, stoi(args[++ix]));
+        else if (arg == "--record-out" && ix+1 < nargs) record_out = args[++ix];
+        else if (arg == "--record-format" && ix+1 < nargs) {
+            string format = args[++ix];
+            if (format == "rgb") record_png = false;
+            else if (format == "png") record_png = true;
+            else die("--record-format takes rgb or png");
+        }
+        else if (arg == "--record-fps" && ix+1 < nargs) {
+            record_fps = max(1.0f, stof(args[++ix]));
+            // faster than the physics step, some frames would step nothing
+            if (double(record_fps) * time_step > 1) {
+                die("--record-fps must be under the physics rate of " + to_string(lround(1 / time_step)) + " steps per second");
+            }
+        }
+        else if (arg == "--trace" && ix+1 < nargs) trace_out = args[++ix];
+        else if (arg == "--frame-graph") show_frame_graph = true;
+        else if (arg == "--no-lua-cache") lua_cache = false;
+        else if (arg == "--no-shader-cache") program_cache = false;
+        else if (arg == "--no-glyph-arena") glyph_arena = false;
+        else if (arg == "--bake-words") bake_words = true;
+        else if (arg == "--gpu-extrude") gpu_extrude = true;
+        else if (arg == "--glyph-budget" && ix+1 < nargs) glyph_budget = max(0.0f, stof(args[++ix])) * 1024 * 1024;
+        else if (arg == "--no-sdf") sdf_text = false;
+        else if (arg == "--colliders" && ix+1 < nargs) {
+            string mode = args[++ix];
+            if (mode == "box") colliders = BOX_COLLIDERS;
+            else if (mode == "hull") colliders = HULL_COLLIDERS;
+            else die("--colliders takes box or hull");
+        }
+        else if (arg == "--stream" && ix+1 < nargs) stream_source = args[++ix];
+        else if (arg == "--stream-cap" && ix+1 < nargs) stream_cap = max(1, stoi(args[++ix]));
+        else if (arg == "--stream-ttl" && ix+1 < nargs) stream_ttl = stof(args[++ix]);
+        else die("usage: text3d [--glyph-threads N] [--glyph-timing] [--no-indirect] [--no-persistent-map] [--half-positions]"
+                 " [--teapot-fineness N] [--bench N] [--bench-out FILE] [--trace FILE] [--frame-graph]"
+                 " [--record N] [--record-out FILE|PATTERN|-] [--record-format rgb|png] [--record-fps F]"
+                 " [--no-lua-cache] [--no-shader-cache] [--no-glyph-arena] [--bake-words] [--gpu-extrude] [--glyph-budget MB] [--no-sdf] [--colliders box|hull] [--stream FILE] [--stream-cap N] [--stream-ttl SECONDS]");
+    }
+}
+
+double last_frame_start = 0;
+
+// everything a frame does on the render thread, each phase profiled
+void render_frame() {
+    double now = profile_now();
+    if (last_frame_start > 0) graph.add(now - last_frame_start);
+    last_frame_start = now;
+
+    gpu_frame.collect();
+    if (reader) {
+        stage_timer timer("stream_update");
+        stream.update();
+    }
+    {
+        stage_timer timer("upload_glyphs");
+        upload_loaded_glyphs();
+        for (auto & word : words) word.refresh();
+        for (auto & slot : stream.slots) slot.word.refresh();
+    }
+    {
+        stage_timer timer("interpolate_poses");
+        interpolate_poses();
+    }
+
+    gpu_frame.begin("gpu_frame");
+    uploads.begin_frame();
+
+    // background color
+    glClearColor(0.2, 0.3, 0.3, 1.0);
+    glEnable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    {
+        stage_timer timer("draw_scene");
+        draw_scene();
+    }
+    if (show_frame_graph) graph.draw();
+
+    uploads.end_frame();
+    gpu_frame.end();
+
+    // recordings read back from their own framebuffer
+    if (record_frames == 0) {
+        stage_timer timer("swap");
+        SDL_GL_SwapWindow(gWindow);
+    }
+    frame += 1;
 }
 
-unsigned int FRAME_TICK;
+// exactly bench_frames frames, each stepping physics 20msec on this thread
+// and waiting for the gpu to finish, then the report
+void run_bench() {
+    for (int n=0 ; n<bench_frames ; n+=1) {
+        stage_timer timer("frame");
 
-uint32_t timer_callback(uint32_t interval, void * param) {
-    SDL_Event e;
-    e.type = FRAME_TICK;
-    SDL_PushEvent(& e);
+        SDL_Event e;
+        while (SDL_PollEvent(& e)) {}
+
+        physics_step(20.0/1000.0);
+        render_frame();
+        glFinish();
+    }
 
-    return interval;
+    write_bench_report();
 }
 
-int frame = 0;
+// png without zlib: the image data goes in stored (uncompressed) deflate
+// blocks, so files are about the size of the raw frame
+uint32_t png_crc(const uint8_t * data, size_t size, uint32_t crc = 0) {
+    static uint32_t table[256];
+    if (! table[1]) {
+        for (uint32_t n=0 ; n<256 ; n+=1) {
+            uint32_t c = n;
+            for (int k=0 ; k<8 ; k+=1) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t ix=0 ; ix<size ; ix+=1) crc = table[(crc ^ data[ix]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+void put_be32(vector<uint8_t> & out, uint32_t v) {
+    out.insert(out.end(), {uint8_t(v >> 24), uint8_t(v >> 16), uint8_t(v >> 8), uint8_t(v)});
+}
+
+void png_chunk(vector<uint8_t> & out, const char * type, const vector<uint8_t> & data) {
+    put_be32(out, data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    put_be32(out, png_crc(& out[start], out.size() - start));
+}
+
+// rows are bottom up, as gl reads them
+void encode_png(const uint8_t * rgb, int width, int height, vector<uint8_t> & out) {
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    out.assign(signature, signature + 8);
+
+    vector<uint8_t> header;
+    put_be32(header, width);
+    put_be32(header, height);
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8 bit rgb
+    png_chunk(out, "IHDR", header);
+
+    // filter byte 0 and the row, top down
+    size_t row_bytes = width * 3;
+    vector<uint8_t> raw((row_bytes + 1) * height);
+    for (int y=0 ; y<height ; y+=1) {
+        uint8_t * row = & raw[y * (row_bytes + 1)];
+        row[0] = 0;
+        memcpy(row + 1, rgb + (height - 1 - y) * row_bytes, row_bytes);
+    }
+
+    vector<uint8_t> z = {0x78, 0x01};
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    for (size_t at=0 ; at<raw.size() ; at+=65535) {
+        uint16_t len = min(raw.size() - at, (size_t) 65535);
+        bool last = at + len >= raw.size();
+        z.insert(z.end(), {uint8_t(last), uint8_t(len), uint8_t(len >> 8), uint8_t(~len), uint8_t(~len >> 8)});
+        z.insert(z.end(), raw.begin() + at, raw.begin() + at + len);
+    }
+    put_be32(z, (b << 16) | a);
+    png_chunk(out, "IDAT", z);
+    png_chunk(out, "IEND", {});
+}
+
+// encodes and writes finished frames off the render thread. frame buffers go
+// round between spare and queue, so no more than FRAME_BUFFERS are ever in
+// memory and a slow disk holds up rendering rather than filling ram
+struct frame_writer {
+    static const int FRAME_BUFFERS = 8;
+
+    thread worker;
+    mutex lock;
+    condition_variable wake;
+    condition_variable returned;
+    deque<vector<uint8_t>> queue;
+    vector<vector<uint8_t>> spare;
+    int nbuffers = 0;
+    bool stopping = false;
+
+    FILE * raw_out = nullptr; // rgb frames back to back
+    int width, height;
+    long written = 0;
+    double stalled = 0; // seconds the render thread waited for a buffer
+
+    void start(int w, int h);
+    vector<uint8_t> take_buffer();
+    void submit(vector<uint8_t> pixels);
+    void run();
+    void finish();
+};
+
+void frame_writer::start(int w, int h) {
+    width = w;
+    height = h;
+    if (record_out == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        raw_out = stdout;
+    } else if (! record_png) {
+        raw_out = fopen(record_out.c_str(), "wb");
+        if (! raw_out) die("can't write " + record_out);
+    }
+    worker = thread(& frame_writer::run, this);
+}
+
+vector<uint8_t> frame_writer::take_buffer() {
+    unique_lock<mutex> guard(lock);
+    if (spare.empty() && nbuffers < FRAME_BUFFERS) {
+        nbuffers += 1;
+        return vector<uint8_t>(width * height * 3);
+    }
+    double start = profile_now();
+    returned.wait(guard, [&]() { return ! spare.empty(); });
+    stalled += profile_now() - start;
+    vector<uint8_t> buffer = move(spare.back());
+    spare.pop_back();
+    return buffer;
+}
+
+void frame_writer::submit(vector<uint8_t> pixels) {
+    lock_guard<mutex> guard(lock);
+    queue.push_back(move(pixels));
+    wake.notify_one();
+}
+
+void frame_writer::run() {
+    name_thread("frame writer");
+    vector<uint8_t> png;
+    while (true) {
+        unique_lock<mutex> guard(lock);
+        wake.wait(guard, [&]() { return stopping || ! queue.empty(); });
+        if (queue.empty()) return;
+        vector<uint8_t> pixels = move(queue.front());
+        queue.pop_front();
+        guard.unlock();
+
+        {
+            stage_timer timer("write_frame");
+            if (! record_png) {
+                // gl rows are bottom up
+                size_t row_bytes = width * 3;
+                for (int y=height-1 ; y>=0 ; y-=1) fwrite(& pixels[y * row_bytes], 1, row_bytes, raw_out);
+            } else {
+                encode_png(pixels.data(), width, height, png);
+                if (raw_out) fwrite(png.data(), 1, png.size(), raw_out);
+                else {
+                    char name[1024];
+                    snprintf(name, sizeof(name), record_out.c_str(), (int) written);
+                    FILE * f = fopen(name, "wb");
+                    if (! f) die(string("can't write ") + name);
+                    fwrite(png.data(), 1, png.size(), f);
+                    fclose(f);
+                }
+            }
+            written += 1;
+        }
+
+        guard.lock();
+        spare.push_back(move(pixels));
+        returned.notify_one();
+    }
+}
+
+void frame_writer::finish() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+        wake.notify_one();
+    }
+    worker.join();
+    if (raw_out) fflush(raw_out);
+    if (raw_out && raw_out != stdout) fclose(raw_out);
+}
+
+// renders into an fbo and reads it back through a ring of pixel pack
+// buffers. each frame's glReadPixels only queues a copy into a pbo; the
+// fence on it is waited for CAPTURE_RING-1 frames later, by when the gpu has
+// long finished, so readback overlaps the frames after it
+struct frame_capture {
+    static const int CAPTURE_RING = 3;
+
+    GLuint fbo = 0;
+    GLuint color = 0;
+    GLuint depth = 0;
+    GLuint pbos[CAPTURE_RING];
+    GLsync fences[CAPTURE_RING] = {};
+    int next = 0;     // slot the next frame reads into
+    int inflight = 0; // slots with a readback queued
+    int width, height;
+    frame_writer * writer;
+
+    void init(int w, int h, frame_writer * out);
+    void capture();
+    void collect();
+    void flush();
+};
+
+void frame_capture::init(int w, int h, frame_writer * out) {
+    width = w;
+    height = h;
+    writer = out;
+
+    glGenRenderbuffers(1, & color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, & depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    // everything draws here from now on, nothing binds framebuffer 0 again
+    glGenFramebuffers(1, & fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) die("framebuffer");
+
+    glGenBuffers(CAPTURE_RING, pbos);
+    for (int ix=0 ; ix<CAPTURE_RING ; ix+=1) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[ix]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, width * height * 3, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+}
+
+// queue the frame just drawn for readback, collecting the oldest first if
+// the ring is full
+void frame_capture::capture() {
+    if (inflight == CAPTURE_RING) collect();
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[next]);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fences[next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    next = (next + 1) % CAPTURE_RING;
+    inflight += 1;
+}
+
+// oldest queued frame to the writer
+void frame_capture::collect() {
+    stage_timer timer("readback");
+    int slot = (next - inflight + CAPTURE_RING) % CAPTURE_RING;
+    glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(fences[slot]);
+    fences[slot] = 0;
+
+    vector<uint8_t> pixels = writer->take_buffer();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[slot]);
+    void * mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pixels.size(), GL_MAP_READ_BIT);
+    if (! mapped) die("map pixel buffer");
+    memcpy(pixels.data(), mapped, pixels.size());
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    writer->submit(move(pixels));
+    inflight -= 1;
+}
+
+void frame_capture::flush() {
+    while (inflight > 0) collect();
+}
+
+// exactly record_frames frames, physics stepped on this thread so that after
+// n frames it has simulated n/record_fps seconds, to the step. a scene
+// records the same way every time, at the speed it plays
+void run_record() {
+    frame_writer writer;
+    writer.start(SCREEN_WIDTH, SCREEN_HEIGHT);
+    frame_capture capture;
+    capture.init(SCREEN_WIDTH, SCREEN_HEIGHT, & writer);
+
+    double start = profile_now();
+    long steps_done = 0;
+    for (int n=0 ; n<record_frames ; n+=1) {
+        stage_timer timer("frame");
+
+        SDL_Event e;
+        while (SDL_PollEvent(& e)) {}
+
+        loader.drain();
+        {
+            stage_timer physics_timer("physics_step");
+            long steps = long(floor((n+1) / (double(record_fps) * time_step)));
+            physics.step(steps - steps_done);
+            steps_done = steps;
+        }
+        render_frame();
+        capture.capture();
+    }
+    capture.flush();
+    writer.finish();
+    double wall = profile_now() - start;
+
+    cerr << "recorded " << writer.written << " frames in " << wall << "s, "
+         << writer.written / wall << " fps (render thread waited "
+         << writer.stalled << "s on the writer)" << endl;
+}
 
 int main(int nargs, char * args[])
 {
+    parse_args(nargs, args);
+    name_thread("render");
+
+    // frames going to stdout need it to themselves
+    if (record_frames > 0 && record_out == "-") cout.rdbuf(cerr.rdbuf());
+
     init();
 
-    load_glyphs();
+    arena.init(1 << 20);
+    uploads.init(1 << 20);
+    frame_draws.init();
+    if (gpu_extrude) {
+        outlines.init(1 << 18);
+        extrude_draws.init();
+    }
+    gpu_frame.init();
+    if (show_frame_graph) graph.init();
+
+    {
+        stage_timer timer("load_glyphs");
+        load_glyphs();
+    }
     //cout << "loaded" << endl;
 
-    load_teapot();
+    {
+        stage_timer timer("load_teapot");
+        load_teapot();
+    }
+
+    {
+        stage_timer timer("setup_shaders");
+        setup_shaders();
+    }
 
-    setup_shaders();
+    if (sdf_text) {
+        stage_timer timer("build_sdf_atlas");
+        build_sdf_atlas();
+        sdf_draws.init();
+    }
     //cout << "shaders" << endl;
 
-    setup_scene();
+    {
+        stage_timer timer("setup_scene");
+        setup_scene();
+    }
     //cout << "scene" << endl;
 
-    // timer tick every 20msec
-    FRAME_TICK = SDL_RegisterEvents(1);
-    SDL_AddTimer(20, timer_callback, NULL);
+    if (! stream_source.empty()) start_stream();
+
+    if (bench_frames > 0) {
+        physics.begin(false);
+        run_bench();
+        close();
+        return 0;
+    }
+
+    if (record_frames > 0) {
+        physics.begin(false);
+        run_record();
+        close();
+        return 0;
+    }
+
+    // physics steps on its own thread from here on, frames are drawn as
+    // fast as the swap allows
+    physics.begin(true);
+    config_watch.watch(CONFIG_FILE);
 
     bool done = false;
     while (! done)
     {
-        SDL_Event e;
-        SDL_WaitEvent(& e); //TODO check for error
+        stage_timer timer("frame");
 
-        if (e.type == SDL_QUIT) done = true;
-        else if (e.type == FRAME_TICK) {
-            //cout << "before physics" << endl;
-            physics_step(20.0/1000.0); // step forward 20msec
-            //cout << "after physics" << endl;
-
-            // background color
-            glClearColor(0.2, 0.3, 0.3, 1.0);
-            glEnable(GL_DEPTH_TEST);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        {
+            stage_timer events_timer("poll_events");
+            SDL_Event e;
+            while (SDL_PollEvent(& e)) {
+                if (e.type == SDL_QUIT) done = true;
+            }
+        }
 
-            //cout << "before draw" << endl;
-            draw_scene();
-            //cout << "after draw" << endl;
-            SDL_GL_SwapWindow(gWindow);
-            frame += 1;
+        if (config_watch.changed()) {
+            stage_timer reload_timer("reload_config");
+            reload_config();
         }
+
+        //cout << "before draw" << endl;
+        render_frame();
+        //cout << "after draw" << endl;
     }
 
     close();
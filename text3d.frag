@@ -0,0 +1,24 @@
+#version 330 core
+out vec4 FragColor;
+in vec3 FragPos;
+in vec3 Normal;
+in vec3 Color;
+uniform vec3 lightPos;
+uniform vec3 lightColor;
+void main() {
+  float ambientStrength = 0.1;
+  vec3 ambient = ambientStrength * lightColor;
+  vec3 norm = -normalize(Normal); //TODO unminus this?
+  vec3 lightDir = normalize(lightPos - FragPos);
+  float diff = max(dot(norm, lightDir), 0.0);
+  vec3 diffuse = diff * lightColor;
+  float specularStrength = 0.25;
+  vec3 viewPos = vec3(0.0, 0.0, 10.0); //TODO make this a uniform
+  vec3 viewDir = normalize(viewPos - FragPos);
+  vec3 reflectDir = reflect(-lightDir, norm);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+  vec3 specular = specularStrength * spec * lightColor;
+
+  vec3 result = (ambient + diffuse + specular) * Color;
+  FragColor = vec4(result, 1.0);
+}
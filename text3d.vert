@@ -0,0 +1,17 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in mat4 aModel;
+layout (location = 6) in mat3 aNormalMatrix;
+layout (location = 9) in vec3 aColor;
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 Color;
+uniform mat4 projection;
+uniform mat4 view;
+void main() {
+  FragPos = aPos;
+  Normal = aNormalMatrix * aNormal;
+  Color = aColor;
+  gl_Position = projection * view * aModel * vec4(aPos, 1.0);
+}
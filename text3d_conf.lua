@@ -1,2 +1,3 @@
 words = {"Error", "418", "", "", "I'm a teapot"}
 colors = {darkred, darkred, white, white, darkslateblue}
+fonts = {"georgiab.ttf", "arial.ttf"}
@@ -0,0 +1,40 @@
+#version 330 core
+// --gpu-extrude: caps come from the glyph's 2d tessellation, drawn twice per
+// letter (front on even instances, back on odd). sides are six vertices per
+// outline edge, read from the edges buffer by gl_VertexID
+layout (location = 0) in vec2 aPos;
+layout (location = 2) in mat4 aModel;
+layout (location = 6) in mat3 aNormalMatrix;
+layout (location = 9) in vec3 aColor;
+layout (location = 10) in float aDepth;
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 Color;
+uniform mat4 projection;
+uniform mat4 view;
+uniform bool sides;
+uniform samplerBuffer edges;
+
+// which end of the edge and which face each side vertex sits on
+const vec2 corners[6] = vec2[6](vec2(1, 1), vec2(0, -1), vec2(1, -1),
+                                vec2(1, 1), vec2(0, 1), vec2(0, -1));
+
+void main() {
+  vec3 pos;
+  vec3 normal;
+  if (sides) {
+    vec4 edge = texelFetch(edges, gl_VertexID / 6);
+    vec2 corner = corners[gl_VertexID % 6];
+    vec2 d = edge.zw - edge.xy;
+    pos = vec3(mix(edge.xy, edge.zw, corner.x), corner.y * aDepth / 2);
+    normal = normalize(vec3(-d.y, d.x, 0));
+  } else {
+    float side = (gl_InstanceID & 1) == 0 ? -1.0 : 1.0;
+    pos = vec3(aPos, side * aDepth / 2);
+    normal = vec3(0, 0, side);
+  }
+  FragPos = pos;
+  Normal = aNormalMatrix * normal;
+  Color = aColor;
+  gl_Position = projection * view * aModel * vec4(pos, 1.0);
+}